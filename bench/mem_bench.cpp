@@ -0,0 +1,151 @@
+/*mem_bench.cpp
+
+author: L1ttle-Q
+date: 2026-10-17
+
+memory simulator micro-benchmark
+
+fill the arena with n equal segments, punch holes into every other one,
+then churn (free a random live segment, apply the same size again) and
+report the average and worst apply/free latency per segment count.
+
+dispatch: the same churn, timed as a whole, through the runtime-selected
+Memory_simulator and through the compile-time specialized simulator.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "mem_simulator.h"
+
+Strategy strategy = first_fit;
+bool Mem_op_print = false;
+
+const int CHURN_OPS = 20000;
+const int DISPATCH_ROUNDS = 5;
+
+struct Bench_result
+{
+    double apply_ns;
+    double free_ns;
+    double apply_max_ns;
+    double free_max_ns;
+};
+
+// n equal segments, every other one freed; live gets the remaining handles
+template <class Sim>
+static void fill(Sim* mem, const int& n, std::vector<int>& live)
+{
+    const int size = MEMORY_STORAGY / n;
+    live.clear();
+    for (int i = 0; i < n; i++)
+    {
+        int id;
+        mem->apply(size, id);
+        if (i & 1) mem->free(id);
+        else live.push_back(id);
+    }
+}
+
+static Bench_result churn(const int& n)
+{
+    using clock = std::chrono::steady_clock;
+    const int size = MEMORY_STORAGY / n;
+    Memory_simulator* mem = new Memory_simulator();
+    std::vector<int> live;
+    std::mt19937 rng(20250510);
+    fill(mem, n, live);
+
+    clock::duration t_apply(0), t_free(0), max_apply(0), max_free(0);
+    for (int i = 0; i < CHURN_OPS; i++)
+    {
+        int k = rng() % live.size();
+        clock::time_point t0 = clock::now();
+        mem->free(live[k]);
+        clock::time_point t1 = clock::now();
+        mem->apply(size, live[k]);
+        clock::time_point t2 = clock::now();
+        t_free += t1 - t0;
+        t_apply += t2 - t1;
+        if (t1 - t0 > max_free) max_free = t1 - t0;
+        if (t2 - t1 > max_apply) max_apply = t2 - t1;
+    }
+    delete mem;
+
+    Bench_result res;
+    res.apply_ns = std::chrono::duration<double, std::nano>(t_apply).count() / CHURN_OPS;
+    res.free_ns = std::chrono::duration<double, std::nano>(t_free).count() / CHURN_OPS;
+    res.apply_max_ns = std::chrono::duration<double, std::nano>(max_apply).count();
+    res.free_max_ns = std::chrono::duration<double, std::nano>(max_free).count();
+    return res;
+}
+
+// ns per free + apply pair, no per-call timing in the loop
+template <class Sim>
+static double churn_pair_ns(const int& n)
+{
+    using clock = std::chrono::steady_clock;
+    const int size = MEMORY_STORAGY / n;
+    Sim* mem = new Sim();
+    std::vector<int> live;
+    std::mt19937 rng(20250510);
+    fill(mem, n, live);
+
+    clock::time_point t0 = clock::now();
+    for (int i = 0; i < CHURN_OPS; i++)
+    {
+        int k = rng() % live.size();
+        mem->free(live[k]);
+        mem->apply(size, live[k]);
+    }
+    double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count() / CHURN_OPS;
+    delete mem;
+    return ns;
+}
+
+template <class Sim>
+static void dispatch_row(const char* name, const Strategy& s, const int& n)
+{
+    strategy = s; // Memory_simulator() picks the global strategy
+    double runtime = 0, specialized = 0;
+    for (int r = 0; r < DISPATCH_ROUNDS; r++) // alternate, keep the best of each
+    {
+        double t = churn_pair_ns<Memory_simulator>(n);
+        if (!r || t < runtime) runtime = t;
+        t = churn_pair_ns<Sim>(n);
+        if (!r || t < specialized) specialized = t;
+    }
+    printf("%-10s %10d %14.1f %14.1f %9.1f%%\n", name, n, runtime, specialized, 100.0 * (runtime - specialized) / runtime);
+}
+
+int main()
+{
+    const Strategy strategies[] = {first_fit, best_fit, next_fit, worst_fit, segregated_fit, tlsf, buddy, bitmap};
+    const char* names[] = {"first fit", "best fit", "next fit", "worst fit", "seg fit", "tlsf", "buddy", "bitmap"};
+    constexpr int strategy_cnt = sizeof(strategies) / sizeof(strategies[0]);
+
+    printf("%-10s %10s %12s %12s %14s %14s\n", "strategy", "segments", "apply(ns)", "free(ns)", "apply max(ns)", "free max(ns)");
+    for (int s = 0; s < strategy_cnt; s++)
+    {
+        strategy = strategies[s];
+        for (int n = 256; n <= MEMORY_STORAGY / 2; n <<= 2)
+        {
+            Bench_result res = churn(n);
+            printf("%-10s %10d %12.1f %12.1f %14.1f %14.1f\n", names[s], n, res.apply_ns, res.free_ns, res.apply_max_ns, res.free_max_ns);
+        }
+    }
+
+    const int n = 1024;
+    printf("\n%-10s %10s %14s %14s %10s\n", "strategy", "segments", "runtime(ns)", "template(ns)", "saved");
+    dispatch_row< Basic_memory_simulator<First_fit_policy> >("first fit", first_fit, n);
+    dispatch_row< Basic_memory_simulator<Best_fit_policy> >("best fit", best_fit, n);
+    dispatch_row< Basic_memory_simulator<Next_fit_policy> >("next fit", next_fit, n);
+    dispatch_row< Basic_memory_simulator<Worst_fit_policy> >("worst fit", worst_fit, n);
+    dispatch_row< Basic_memory_simulator<Segregated_fit_policy> >("seg fit", segregated_fit, n);
+    dispatch_row< Engine_simulator<Tlsf_engine> >("tlsf", tlsf, n);
+    dispatch_row< Engine_simulator<Buddy_engine> >("buddy", buddy, n);
+    dispatch_row< Engine_simulator<Bitmap_engine> >("bitmap", bitmap, n);
+    return 0;
+}
@@ -0,0 +1,176 @@
+/*mem_mt_bench.cpp
+
+author: L1ttle-Q
+date: 2026-10-17
+
+multi-threaded allocator stress benchmark
+
+every worker churns its own live set on one shared arena: mostly small
+requests with a tail of large ones, each freed in random order (some on
+another worker's behalf, through a shared hand-off slot). throughput in
+million apply+free calls per second is reported per thread count, for a
+Memory_simulator behind one mutex (locked) and for Concurrent_simulator
+(cached), with the backend strategy given on the command line.
+
+usage: mem_mt_bench [strategy] [max threads]
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "mem_concurrent.h"
+
+Strategy strategy = tlsf;
+bool Mem_op_print = false;
+
+const int OPS_PER_THREAD = 200000;
+const int LIVE_MAX = 256;
+const int ARENA_PER_THREAD = 1 << 20;
+const int ROUNDS = 3;
+
+// one mutex around the plain simulator, the baseline
+class Locked_simulator
+{
+private:
+    Memory_simulator mem;
+    std::mutex lock;
+
+public:
+    explicit Locked_simulator(const int& size): mem(size)
+    {
+        mem.set_auto_compact(false);
+    }
+    int apply(const int& size, int& handle)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return mem.apply(size, handle);
+    }
+    bool free(const int& handle, const int&)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return mem.free(handle);
+    }
+    void flush_thread_cache() {}
+};
+
+struct Block
+{
+    int handle;
+    int size;
+};
+
+// a block one worker leaves for the next one to free
+struct Handoff
+{
+    std::mutex lock;
+    std::vector<Block> blocks;
+};
+
+template <class Sim>
+static void worker(Sim* mem, Handoff* handoff, const int& seed, std::atomic<long long>* fails)
+{
+    std::mt19937 rng(seed);
+    std::vector<Block> live;
+    live.reserve(LIVE_MAX);
+    long long fail = 0;
+    for (int op = 0; op < OPS_PER_THREAD; op++)
+    {
+        unsigned int r = rng() % 100;
+        if ((int)live.size() >= LIVE_MAX || (!live.empty() && r < 48))
+        {
+            int k = rng() % live.size();
+            Block b = live[k];
+            live[k] = live.back();
+            live.pop_back();
+            if (r < 4) // leave it to whichever worker comes next
+            {
+                std::lock_guard<std::mutex> guard(handoff->lock);
+                handoff->blocks.push_back(b);
+                if (handoff->blocks.size() < 64) continue;
+                b = handoff->blocks.front();
+                handoff->blocks.erase(handoff->blocks.begin());
+            }
+            mem->free(b.handle, b.size);
+        }
+        else
+        {
+            Block b;
+            b.size = r < 90 ? 1 + rng() % 128 : 257 + rng() % 4096;
+            if (mem->apply(b.size, b.handle) == -1) fail++;
+            else live.push_back(b);
+        }
+    }
+    for (const Block& b : live) mem->free(b.handle, b.size);
+    mem->flush_thread_cache();
+    fails->fetch_add(fail);
+}
+
+// million apply+free calls per second, best of ROUNDS
+template <class Sim>
+static double throughput(const int& threads, long long& fails, Concurrent_simulator::Cache_stats* cache)
+{
+    double best = 0;
+    fails = 0;
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        Sim* mem = new Sim(ARENA_PER_THREAD * threads);
+        Handoff handoff;
+        std::atomic<long long> fail(0);
+        std::vector<std::thread> pool;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (int t = 0; t < threads; t++)
+            pool.emplace_back(worker<Sim>, mem, &handoff, 20261017 + t, &fail);
+        for (std::thread& th : pool) th.join();
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        for (const Block& b : handoff.blocks) mem->free(b.handle, b.size);
+        best = std::max(best, (double)OPS_PER_THREAD * threads / s / 1e6);
+        fails += fail.load();
+        if constexpr (std::is_same<Sim, Concurrent_simulator>::value)
+            if (cache) *cache = mem->cache_stats();
+        delete mem;
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    const char* StrategyStr[] = {"first", "best", "next", "worst", "segregated", "tlsf", "buddy", "bitmap"};
+    if (argc > 1)
+    {
+        int s = 0;
+        while (s < 8 && strcmp(argv[1], StrategyStr[s])) s++;
+        if (s == 8)
+        {
+            fprintf(stderr, "error: unknown strategy %s.\n", argv[1]);
+            return 1;
+        }
+        strategy = (Strategy)s;
+    }
+    int max_threads = argc > 2 ? atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+    if (max_threads < 1) max_threads = 1;
+
+    printf("backend %s, %d ops per thread, %d hardware threads\n(Mops/s, best of %d)\n\n",
+           StrategyStr[strategy], OPS_PER_THREAD, (int)std::thread::hardware_concurrency(), ROUNDS);
+    printf("%7s %10s %10s %8s %8s %7s\n", "threads", "locked", "cached", "speedup", "hit%", "fails");
+    for (int threads = 1;; threads = std::min(threads * 2, max_threads))
+    {
+        long long locked_fails, cached_fails;
+        Concurrent_simulator::Cache_stats cache;
+        double locked = throughput<Locked_simulator>(threads, locked_fails, nullptr);
+        double cached = throughput<Concurrent_simulator>(threads, cached_fails, &cache);
+        long long small = cache.hits + cache.refills;
+        printf("%7d %10.2f %10.2f %7.2fx %7.1f%% %7lld\n", threads, locked, cached, cached / locked,
+               small ? 100.0 * cache.hits / small : 0.0, locked_fails + cached_fails);
+        if (threads == max_threads) break;
+    }
+    return 0;
+}
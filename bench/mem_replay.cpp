@@ -0,0 +1,247 @@
+/*mem_replay.cpp
+
+author: L1ttle-Q
+date: 2026-10-17
+
+allocator trace replay
+
+replays a trace recorded with file_simulator --trace <path> (see mem_trace.h)
+against every strategy and reports, per strategy:
+apply/free latency percentiles, the apply failure rate, the peak segment
+count, the final arena size and the largest free block along the trace.
+without an argument a synthetic mixed-size workload is recorded first.
+
+zones: the segment-list strategies are replayed again with placement zones
+(requests above the boundary placed apart from the smaller ones, see
+mem_simulator.h), and the mean and final external fragmentation of both
+layouts are compared.
+
+usage: mem_replay [trace] [zone boundary]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "mem_simulator.h"
+
+Strategy strategy = first_fit;
+bool Mem_op_print = false;
+
+const int CURVE_POINTS = 10;  // largest free block sampled at every tenth of the trace
+const int SEGMENT_SAMPLES = 1024; // segment count sampled this many times along the trace
+const int SYNTHETIC_OPS = 100000;
+const char SYNTHETIC_TRACE[] = "synthetic.mtrace";
+const int ZONE_BOUNDARY = 128; // default: above the synthetic small requests, below the large ones
+
+struct Replay_result
+{
+    std::vector<long long> apply_ns;
+    std::vector<long long> free_ns;
+    int apply_fail;
+    int resizes;
+    int resize_fail; // not grown in place: the file layer then adds an extent
+    int peak_segments;
+    int capacity;
+    double frag_mean; // external fragmentation, averaged over the segment samples
+    double frag_final;
+    int curve[CURVE_POINTS];
+};
+
+// files the way the file layer makes them: created with one byte, grown by
+// small appends (in place when possible, else a new extent), large payloads
+// written whole, whole files deleted
+static bool record_synthetic(const char* path)
+{
+    Trace_recorder recorder;
+    if (!recorder.open(path, MEMORY_STORAGY, 1 << 20)) return false;
+    Memory_simulator* mem = new Memory_simulator();
+    mem->bind_storage(nullptr, nullptr, 1 << 20);
+    mem->set_trace(&recorder);
+
+    struct File
+    {
+        std::vector<int> extents;
+        int last_size;
+    };
+    std::mt19937 rng(20261017);
+    std::vector<File> files;
+    for (int i = 0; i < SYNTHETIC_OPS; i++)
+    {
+        unsigned int r = rng() % 100;
+        File f;
+        int id;
+        if (files.size() > 64 && (r >= 85 || files.size() > 1024))
+        {
+            int k = rng() % files.size();
+            for (int e : files[k].extents) mem->free(e);
+            files[k] = files.back();
+            files.pop_back();
+        }
+        else if (!files.empty() && r >= 35 && r < 75)
+        {
+            File& g = files[rng() % files.size()];
+            int len = 1 + rng() % 32;
+            if (mem->resize(g.extents.back(), g.last_size + len)) g.last_size += len;
+            else if (mem->apply(len, id) != -1)
+            {
+                g.extents.push_back(id);
+                g.last_size = len;
+            }
+        }
+        else
+        {
+            f.last_size = r < 75 ? 1 : 512 + rng() % 2048;
+            if (mem->apply(f.last_size, id) == -1) continue;
+            f.extents.push_back(id);
+            files.push_back(f);
+        }
+    }
+    delete mem;
+    recorder.close();
+    return true;
+}
+
+static long long percentile(std::vector<long long>& v, const double& p)
+{
+    if (v.empty()) return 0;
+    size_t k = (size_t)(p * (v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+static Replay_result replay(const Trace_header& header, const std::vector<Trace_record>& records, const int& zones)
+{
+    using clock = std::chrono::steady_clock;
+    Replay_result res;
+    res.apply_fail = 0;
+    res.resizes = res.resize_fail = 0;
+    res.peak_segments = 0;
+    res.frag_mean = 0;
+    int frag_samples = 0;
+    Memory_simulator* mem = new Memory_simulator(header.arena);
+    mem->bind_storage(nullptr, nullptr, header.limit);
+    mem->set_zones(zones);
+    std::unordered_map<int, int> handles; // recorded handle -> replay handle
+
+    const int n = records.size();
+    const int sample_step = n / SEGMENT_SAMPLES > 0 ? n / SEGMENT_SAMPLES : 1;
+    int next_point = 0;
+    for (int i = 0; i < n; i++)
+    {
+        const Trace_record& rec = records[i];
+        if (rec.op == trace_apply)
+        {
+            int id;
+            clock::time_point t0 = clock::now();
+            int first = mem->apply(rec.size, id);
+            res.apply_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count());
+            if (first == -1) res.apply_fail++;
+            else if (rec.handle != -1) handles[rec.handle] = id;
+        }
+        else
+        {
+            auto it = handles.find(rec.handle);
+            if (it != handles.end()) // absent: the recorded or the replayed apply failed
+            {
+                if (rec.op == trace_resize)
+                {
+                    res.resizes++;
+                    if (!mem->resize(it->second, rec.size)) res.resize_fail++;
+                }
+                else
+                {
+                    clock::time_point t0 = clock::now();
+                    mem->free(it->second);
+                    res.free_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count());
+                    handles.erase(it);
+                }
+            }
+        }
+        if (i % sample_step == 0)
+        {
+            res.peak_segments = std::max(res.peak_segments, mem->segments());
+            res.frag_mean += mem->stats().fragmentation;
+            frag_samples++;
+        }
+        while (next_point < CURVE_POINTS && (long long)(i + 1) * CURVE_POINTS >= (long long)(next_point + 1) * n)
+            res.curve[next_point++] = mem->largest_free();
+    }
+    while (next_point < CURVE_POINTS) res.curve[next_point++] = mem->largest_free();
+    res.capacity = mem->capacity();
+    res.frag_mean = frag_samples ? res.frag_mean / frag_samples : 0;
+    res.frag_final = mem->stats().fragmentation;
+    delete mem;
+    return res;
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : SYNTHETIC_TRACE;
+    const int zones = argc > 2 ? atoi(argv[2]) : ZONE_BOUNDARY;
+    if (argc <= 1)
+    {
+        strategy = first_fit;
+        if (!record_synthetic(path)) return 1;
+    }
+    Trace_header header;
+    std::vector<Trace_record> records;
+    if (!load_trace(path, header, records)) return 1;
+
+    int cnt[3] = {0, 0, 0};
+    for (const auto& rec : records) cnt[rec.op]++;
+    printf("trace: %s, %d apply, %d free, %d resize, arena %d bytes up to %d\n(latency in ns)\n\n",
+           path, cnt[trace_apply], cnt[trace_free], cnt[trace_resize], header.arena, header.limit);
+
+    const Strategy strategies[] = {first_fit, best_fit, next_fit, worst_fit, segregated_fit, tlsf, buddy, bitmap};
+    const char* names[] = {"first fit", "best fit", "next fit", "worst fit", "seg fit", "tlsf", "buddy", "bitmap"};
+    constexpr int strategy_cnt = sizeof(strategies) / sizeof(strategies[0]);
+
+    Replay_result results[strategy_cnt];
+    printf("%-10s %9s %9s %9s %10s %9s %9s %7s %9s %10s\n", "strategy", "apply p50", "apply p90", "apply p99",
+           "apply max", "free p50", "free p99", "fail%", "peak seg", "arena");
+    for (int s = 0; s < strategy_cnt; s++)
+    {
+        strategy = strategies[s];
+        Replay_result& res = results[s];
+        res = replay(header, records, 0);
+        int applies = res.apply_ns.size();
+        printf("%-10s %9lld %9lld %9lld %10lld %9lld %9lld %7.2f %9d %10d\n", names[s],
+               percentile(res.apply_ns, 0.5), percentile(res.apply_ns, 0.9), percentile(res.apply_ns, 0.99),
+               percentile(res.apply_ns, 1.0), percentile(res.free_ns, 0.5), percentile(res.free_ns, 0.99),
+               applies ? 100.0 * res.apply_fail / applies : 0.0, res.peak_segments, res.capacity);
+    }
+
+    printf("\nlargest free block (bytes) along the trace:\n%-10s", "strategy");
+    for (int k = 1; k <= CURVE_POINTS; k++) printf(" %8d%%", k * 100 / CURVE_POINTS);
+    printf("\n");
+    for (int s = 0; s < strategy_cnt; s++)
+    {
+        printf("%-10s", names[s]);
+        for (int k = 0; k < CURVE_POINTS; k++) printf(" %9d", results[s].curve[k]);
+        printf("\n");
+    }
+
+    const int list_cnt = 5; // first fit .. seg fit; the engines have no zones
+    printf("\nzones (boundary %d bytes): external fragmentation (1 - largest free / free),\n"
+           "apply failures, resizes not done in place\n", zones);
+    printf("%-10s %10s %10s %10s %11s %9s %9s %9s %9s\n", "strategy", "mean", "mean zoned", "final", "final zoned",
+           "fail%", "zoned", "resize x%", "zoned");
+    for (int s = 0; s < list_cnt; s++)
+    {
+        strategy = strategies[s];
+        Replay_result zoned = replay(header, records, zones);
+        int applies = zoned.apply_ns.size();
+        const Replay_result& plain = results[s];
+        printf("%-10s %10.3f %10.3f %10.3f %11.3f %9.2f %9.2f %9.2f %9.2f\n", names[s], plain.frag_mean, zoned.frag_mean,
+               plain.frag_final, zoned.frag_final,
+               applies ? 100.0 * plain.apply_fail / applies : 0.0, applies ? 100.0 * zoned.apply_fail / applies : 0.0,
+               plain.resizes ? 100.0 * plain.resize_fail / plain.resizes : 0.0,
+               zoned.resizes ? 100.0 * zoned.resize_fail / zoned.resizes : 0.0);
+    }
+    return 0;
+}
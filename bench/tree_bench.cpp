@@ -0,0 +1,403 @@
+/*tree_bench.cpp
+
+author: L1ttle-Q
+date: 2026-10-17
+
+directory tree benchmark
+
+builds the same tree of folders and one-extent files twice: as the
+pointer-linked control blocks the namespace used to be (polymorphic,
+pooled, 64-byte inline names, a vector of extents per file; replicated
+here), and as an Inode_table (see inode_table.h). then reports, best of
+ROUNDS:
+walk: a full traversal reading every name and extent, telling blocks apart
+with dynamic_cast (the old blocks, twice per folder as the traversals
+did), with the kind tag (the old blocks), and over the inode table;
+erase: dropping the whole tree, collecting every segment handle;
+bytes per node: what the structures hold (heap headers not counted).
+
+and resolves LOOKUPS random full-depth file paths component by component,
+drawn from a working set of hot paths or from the whole tree, once with
+Inode_table::find_child and once through the dentry cache (lookup).
+
+usage: tree_bench [fanout] [depth] [files per folder] [hot paths]
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "inode_table.h"
+#include "node_pool.h"
+
+const int ROUNDS = 5;
+const int LOOKUPS = 1 << 20;
+
+// the control blocks as they were before the inode table
+class Legacy_block
+{
+public:
+    char name[MAX_NAME_LENGTH];
+    time_t ctime, mtime;
+    int rwx;
+    Node_kind kind;
+    Legacy_block* sibling;
+    Legacy_block* prev_sibling;
+
+    Legacy_block(const char* _name, const Node_kind& _kind):
+        ctime(0), mtime(0), rwx(0777), kind(_kind), sibling(nullptr), prev_sibling(nullptr)
+    {
+        snprintf(name, sizeof(name), "%s", _name);
+    }
+    virtual ~Legacy_block() {}
+    virtual int Size() const {return 0;}
+    bool is_folder() const {return kind == kind_folder;}
+};
+
+class Legacy_file : public Legacy_block
+{
+public:
+    struct Extent
+    {
+        int first;
+        int id;
+        int size;
+    };
+    std::vector<Extent> extents;
+    int size;
+    Legacy_block* parent;
+
+    Legacy_file(const char* _name, Legacy_block* _parent): Legacy_block(_name, kind_file), size(0), parent(_parent) {}
+    int Size() const {return size;}
+
+    static void* operator new(size_t) {return pool().get();}
+    static void operator delete(void* p) {pool().put(p);}
+    static Node_pool<Legacy_file>& pool()
+    {
+        static Node_pool<Legacy_file> blocks;
+        return blocks;
+    }
+};
+
+class Legacy_folder : public Legacy_block
+{
+public:
+    Legacy_folder* parent;
+    Legacy_block* ch;
+    int child_cnt;
+    void* index;
+    int total_size, file_cnt;
+
+    Legacy_folder(const char* _name, Legacy_folder* _parent):
+        Legacy_block(_name, kind_folder), parent(_parent), ch(nullptr), child_cnt(0), index(nullptr),
+        total_size(0), file_cnt(0) {}
+    ~Legacy_folder()
+    {
+        for (Legacy_block* p = ch, *next; p; p = next)
+        {
+            next = p->sibling;
+            delete p;
+        }
+    }
+    int Size() const {return total_size;}
+
+    void add_child(Legacy_block* p)
+    {
+        p->sibling = ch;
+        if (ch) ch->prev_sibling = p;
+        ch = p;
+        child_cnt++;
+    }
+
+    static void* operator new(size_t) {return pool().get();}
+    static void operator delete(void* p) {pool().put(p);}
+    static Node_pool<Legacy_folder>& pool()
+    {
+        static Node_pool<Legacy_folder> blocks;
+        return blocks;
+    }
+};
+
+struct Tree_shape
+{
+    int fanout;
+    int depth;
+    int files;
+};
+
+static void build_legacy(Legacy_folder* p, const Tree_shape& shape, const int& depth, int& id)
+{
+    char name[MAX_NAME_LENGTH];
+    for (int i = 0; i < shape.files; i++)
+    {
+        snprintf(name, sizeof(name), "f%d", i);
+        Legacy_file* f = new Legacy_file(name, p);
+        f->extents.push_back(Legacy_file::Extent{id, id, 1});
+        f->size = 1;
+        id++;
+        p->add_child(f);
+    }
+    if (!depth) return;
+    for (int i = 0; i < shape.fanout; i++)
+    {
+        snprintf(name, sizeof(name), "d%d", i);
+        Legacy_folder* sub = new Legacy_folder(name, p);
+        p->add_child(sub);
+        build_legacy(sub, shape, depth - 1, id);
+    }
+}
+
+static void build_inodes(Inode_table& table, const int& p, const Tree_shape& shape, const int& depth, int& id)
+{
+    char name[MAX_NAME_LENGTH];
+    for (int i = 0; i < shape.files; i++)
+    {
+        snprintf(name, sizeof(name), "f%d", i);
+        int f = table.create(name, kind_file, 0, 0777);
+        table.add_extent(f, id, id, 1);
+        table[f].size = 1;
+        id++;
+        table.add_child(p, f);
+    }
+    if (!depth) return;
+    for (int i = 0; i < shape.fanout; i++)
+    {
+        snprintf(name, sizeof(name), "d%d", i);
+        int sub = table.create(name, kind_folder, 0, 0777);
+        table.add_child(p, sub);
+        build_inodes(table, sub, shape, depth - 1, id);
+    }
+}
+
+// the checksums keep the walks from being optimized away
+static long long walk_rtti(Legacy_folder* root)
+{
+    long long sum = 0;
+    std::vector<Legacy_folder*> stack(1, root);
+    while (!stack.empty())
+    {
+        Legacy_folder* cur = stack.back();
+        stack.pop_back();
+        for (Legacy_block* ch = cur->ch; ch; ch = ch->sibling)
+        {
+            sum += ch->name[1];
+            if (dynamic_cast<Legacy_folder*>(ch))
+            {
+                stack.push_back(dynamic_cast<Legacy_folder*>(ch));
+                continue;
+            }
+            for (const auto& e : dynamic_cast<Legacy_file*>(ch)->extents) sum += e.first;
+        }
+    }
+    return sum;
+}
+
+static long long walk_tag(Legacy_folder* root)
+{
+    long long sum = 0;
+    std::vector<Legacy_folder*> stack(1, root);
+    while (!stack.empty())
+    {
+        Legacy_folder* cur = stack.back();
+        stack.pop_back();
+        for (Legacy_block* ch = cur->ch; ch; ch = ch->sibling)
+        {
+            sum += ch->name[1];
+            if (ch->is_folder())
+            {
+                stack.push_back(static_cast<Legacy_folder*>(ch));
+                continue;
+            }
+            for (const auto& e : static_cast<Legacy_file*>(ch)->extents) sum += e.first;
+        }
+    }
+    return sum;
+}
+
+static long long walk_inodes(const Inode_table& table, const int& root)
+{
+    long long sum = 0;
+    std::vector<int> stack(1, root);
+    while (!stack.empty())
+    {
+        int cur = stack.back();
+        stack.pop_back();
+        for (int ch = table[cur].folder.child; ~ch; ch = table[ch].sibling)
+        {
+            const Inode& node = table[ch];
+            sum += table.name(ch)[1];
+            if (node.is_folder())
+            {
+                stack.push_back(ch);
+                continue;
+            }
+            for (int k = node.file.extent; ~k; k = table.extent(k).next) sum += table.extent(k).first;
+        }
+    }
+    return sum;
+}
+
+// the legacy tree handed its segments back one file at a time while deleting
+static long long erase_legacy(Legacy_folder* root)
+{
+    long long sum = 0;
+    std::vector<Legacy_folder*> stack(1, root);
+    while (!stack.empty())
+    {
+        Legacy_folder* cur = stack.back();
+        stack.pop_back();
+        for (Legacy_block* ch = cur->ch; ch; ch = ch->sibling)
+            if (ch->is_folder()) stack.push_back(static_cast<Legacy_folder*>(ch));
+            else for (const auto& e : static_cast<Legacy_file*>(ch)->extents) sum += e.id;
+    }
+    delete root;
+    return sum;
+}
+
+static std::string random_path(const Tree_shape& shape, std::mt19937& rng)
+{
+    std::string path;
+    char name[MAX_NAME_LENGTH];
+    for (int d = 0; d < shape.depth; d++)
+    {
+        snprintf(name, sizeof(name), "/d%d", (int)(rng() % shape.fanout));
+        path += name;
+    }
+    snprintf(name, sizeof(name), "/f%d", (int)(rng() % shape.files));
+    return path + name;
+}
+
+static long long resolve_all(Inode_table& table, const int& root, const std::vector<std::string>& paths,
+                             const std::vector<int>& order, const bool& cached)
+{
+    long long sum = 0;
+    char name[MAX_NAME_LENGTH];
+    for (int k : order)
+    {
+        const char* s = paths[k].c_str();
+        int p = root;
+        while (*s == '/')
+        {
+            s++;
+            int len = strcspn(s, "/");
+            memcpy(name, s, len);
+            name[len] = '\0';
+            s += len;
+            p = cached ? table.lookup(p, name) : table.find_child(p, name);
+        }
+        sum += p;
+    }
+    return sum;
+}
+
+static double elapsed_ns(const std::chrono::steady_clock::time_point& t0)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char** argv)
+{
+    Tree_shape shape;
+    shape.fanout = argc > 1 ? atoi(argv[1]) : 8;
+    shape.depth = argc > 2 ? atoi(argv[2]) : 5;
+    shape.files = argc > 3 ? atoi(argv[3]) : 16;
+    const int hot = argc > 4 ? atoi(argv[4]) : 256;
+
+    double walk[3] = {0, 0, 0}, erase[2] = {0, 0};
+    long long sums[5] = {0, 0, 0, 0, 0};
+    int blocks = 0, files = 0;
+    long long legacy_bytes = 0, inode_bytes = 0;
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        int id = 0;
+        Legacy_folder* legacy = new Legacy_folder("", nullptr);
+        build_legacy(legacy, shape, shape.depth, id);
+        files = id;
+
+        Inode_table table;
+        int root = table.create("", kind_folder, 0, 0777);
+        id = 0;
+        build_inodes(table, root, shape, shape.depth, id);
+        blocks = table.size() - 1;
+
+        if (!round)
+        {
+            const int folders = blocks - files;
+            legacy_bytes = (long long)files * (sizeof(Legacy_file) + sizeof(Legacy_file::Extent)) +
+                           (long long)folders * sizeof(Legacy_folder);
+            inode_bytes = table.bytes();
+        }
+
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        sums[0] = walk_rtti(legacy);
+        double ns[5];
+        ns[0] = elapsed_ns(t0);
+        t0 = std::chrono::steady_clock::now();
+        sums[1] = walk_tag(legacy);
+        ns[1] = elapsed_ns(t0);
+        t0 = std::chrono::steady_clock::now();
+        sums[2] = walk_inodes(table, root);
+        ns[2] = elapsed_ns(t0);
+
+        t0 = std::chrono::steady_clock::now();
+        sums[3] = erase_legacy(legacy);
+        ns[3] = elapsed_ns(t0);
+        std::vector<int> ids;
+        t0 = std::chrono::steady_clock::now();
+        table.erase(root, ids);
+        ns[4] = elapsed_ns(t0);
+        sums[4] = 0;
+        for (int h : ids) sums[4] += h;
+
+        for (int k = 0; k < 3; k++)
+            if (!round || ns[k] < walk[k]) walk[k] = ns[k];
+        for (int k = 0; k < 2; k++)
+            if (!round || ns[3 + k] < erase[k]) erase[k] = ns[3 + k];
+    }
+
+    printf("tree: fanout %d, depth %d, %d files per folder, %d blocks (%d files)\n(ns per block, best of %d)\n\n",
+           shape.fanout, shape.depth, shape.files, blocks, files, ROUNDS);
+    printf("%-22s %8s %8s %14s\n", "layout", "walk", "erase", "bytes/block");
+    printf("%-22s %8.2f %8s %14s\n", "blocks, dynamic_cast", walk[0] / blocks, "", "");
+    printf("%-22s %8.2f %8.2f %14.1f\n", "blocks, kind tag", walk[1] / blocks, erase[0] / blocks, (double)legacy_bytes / blocks);
+    printf("%-22s %8.2f %8.2f %14.1f\n", "inode table", walk[2] / blocks, erase[1] / blocks, (double)inode_bytes / blocks);
+    if (sums[0] != sums[1] || sums[1] != sums[2] || sums[3] != sums[4]) printf("(checksum mismatch)\n");
+
+    Inode_table table;
+    int root = table.create("", kind_folder, 0, 0777);
+    int id = 0;
+    build_inodes(table, root, shape, shape.depth, id);
+    std::mt19937 rng(2026);
+    printf("\npath lookup: %d paths of %d components (ns per path, best of %d)\n\n", LOOKUPS, shape.depth + 1, ROUNDS);
+    printf("%-22s %10s %10s %10s\n", "paths", "find_child", "cached", "hit rate");
+    for (int set = 0; set < 2; set++)
+    {
+        std::vector<std::string> paths(set ? LOOKUPS : hot);
+        for (std::string& path : paths) path = random_path(shape, rng);
+        std::vector<int> order(LOOKUPS);
+        for (int& k : order) k = rng() % paths.size();
+
+        double ns[2] = {0, 0};
+        long long check[2] = {0, 0};
+        const long long hits = table.dentry_cache().hits(), misses = table.dentry_cache().misses();
+        for (int round = 0; round < ROUNDS; round++)
+            for (int cached = 0; cached < 2; cached++)
+            {
+                std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+                check[cached] = resolve_all(table, root, paths, order, cached);
+                double t = elapsed_ns(t0);
+                if (!round || t < ns[cached]) ns[cached] = t;
+            }
+        const long long h = table.dentry_cache().hits() - hits, m = table.dentry_cache().misses() - misses;
+        char label[64];
+        if (set) snprintf(label, sizeof(label), "whole tree");
+        else snprintf(label, sizeof(label), "%d hot", hot);
+        printf("%-22s %10.1f %10.1f %9.1f%%\n", label, ns[0] / LOOKUPS, ns[1] / LOOKUPS, 100.0 * h / (h + m));
+        if (check[0] != check[1]) printf("(checksum mismatch)\n");
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*arena.h
+
+author: L1ttle-Q
+date: 2026-10-17
+
+byte arena behind the simulated memory
+
+linux: anonymous mmap, grown with mremap (pages move, bytes are not copied)
+else:  new[], grown by copying into a larger block
+the base may change on growth; callers keep offsets, not pointers.
+
+image mode (linux): the arena is a shared mapping of a file, so its bytes
+persist without any copy; growth extends the file first. one per process.
+the file starts with one header page (magic, generation) ahead of the
+arena bytes; the generation ties the bytes to the metadata saved with them.
+*/
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <new>
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+const int ARENA_FILE_HEADER = 4096; // header page of an image file, the arena follows it
+const char ARENA_FILE_MAGIC[8] = "FSARENA";
+
+struct Arena_file_header
+{
+    char magic[8];
+    long long generation;
+};
+
+inline int arena_file_fd = -1;
+inline char* arena_file_base = nullptr;
+inline Arena_file_header* arena_file_header = nullptr;
+
+inline char* arena_alloc(const int& size)
+{
+#ifdef __linux__
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? nullptr : static_cast<char*>(p);
+#else
+    return new (std::nothrow) char[size]();
+#endif
+}
+
+// map path as the arena; size is the length for a new file and returns
+// the length of an existing one. nullptr on failure (not an image file) or without mmap
+inline char* arena_map_file(const char* path, int& size)
+{
+#ifdef __linux__
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) || (st.st_size && (st.st_size <= ARENA_FILE_HEADER || st.st_size > ARENA_FILE_HEADER + (1 << 30))))
+    {
+        close(fd);
+        return nullptr;
+    }
+    bool fresh = !st.st_size;
+    if (fresh && ftruncate(fd, ARENA_FILE_HEADER + size)) {close(fd); return nullptr;}
+    if (!fresh) size = (int)(st.st_size - ARENA_FILE_HEADER);
+    void* h = mmap(nullptr, ARENA_FILE_HEADER, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (h == MAP_FAILED) {close(fd); return nullptr;}
+    Arena_file_header* header = static_cast<Arena_file_header*>(h);
+    if (fresh)
+    {
+        memcpy(header->magic, ARENA_FILE_MAGIC, sizeof(ARENA_FILE_MAGIC));
+        header->generation = 0;
+    }
+    void* p = memcmp(header->magic, ARENA_FILE_MAGIC, sizeof(ARENA_FILE_MAGIC)) ? MAP_FAILED :
+              mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, ARENA_FILE_HEADER);
+    if (p == MAP_FAILED) {munmap(h, ARENA_FILE_HEADER); close(fd); return nullptr;}
+    arena_file_fd = fd;
+    arena_file_header = header;
+    return arena_file_base = static_cast<char*>(p);
+#else
+    (void)path; (void)size;
+    return nullptr;
+#endif
+}
+
+// 0 without an image file
+inline long long arena_file_generation()
+{
+    return arena_file_header ? arena_file_header->generation : 0;
+}
+
+// written through to the file before it returns
+inline bool arena_set_generation(const long long& generation)
+{
+#ifdef __linux__
+    if (!arena_file_header) return false;
+    arena_file_header->generation = generation;
+    return !msync(arena_file_header, ARENA_FILE_HEADER, MS_SYNC);
+#else
+    (void)generation;
+    return false;
+#endif
+}
+
+inline bool arena_sync(char* base, const int& size)
+{
+#ifdef __linux__
+    return base != arena_file_base || !msync(base, size, MS_SYNC);
+#else
+    (void)base; (void)size;
+    return true;
+#endif
+}
+
+// nullptr on failure, the old block is then still valid
+inline char* arena_grow(char* base, const int& size, const int& new_size)
+{
+#ifdef __linux__
+    if (base == arena_file_base)
+    {
+        if (ftruncate(arena_file_fd, ARENA_FILE_HEADER + new_size)) return nullptr;
+        void* p = mremap(base, size, new_size, MREMAP_MAYMOVE);
+        if (p == MAP_FAILED) return nullptr;
+        return arena_file_base = static_cast<char*>(p);
+    }
+    void* p = mremap(base, size, new_size, MREMAP_MAYMOVE);
+    return p == MAP_FAILED ? nullptr : static_cast<char*>(p);
+#else
+    char* p = new (std::nothrow) char[new_size]();
+    if (!p) return nullptr;
+    memcpy(p, base, size);
+    delete[] base;
+    return p;
+#endif
+}
+
+inline void arena_free(char* base, const int& size)
+{
+    if (!base) return;
+#ifdef __linux__
+    munmap(base, size);
+    if (base == arena_file_base)
+    {
+        munmap(arena_file_header, ARENA_FILE_HEADER);
+        close(arena_file_fd);
+        arena_file_fd = -1;
+        arena_file_base = nullptr;
+        arena_file_header = nullptr;
+    }
+#else
+    (void)size;
+    delete[] base;
+#endif
+}
+
+#endif /* _ARENA_H_ */
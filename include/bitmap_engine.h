@@ -0,0 +1,360 @@
+/*bitmap_engine.h
+
+author: L1ttle-Q
+date: 2026-10-17
+
+bitmap block engine
+
+the arena is cut into fixed blocks of block_size bytes, one bit each:
+used   -- block belongs to an allocation
+start  -- first block of an allocation (validates handles)
+finish -- last block of an allocation (gives the length on free)
+all metadata is three flat word arrays; apply/free never allocate.
+apply is first fit over runs of zero bits. whole words that cannot
+hold the run boundary are skipped 4 (AVX2) or 2 (SSE2) words at a
+time, with a scalar fallback. build with -mavx2 (ENABLE_AVX2) for the
+wide path.
+a run tree keeps the clear run at each end and the longest one inside,
+per group of used words and joined up a flat binary tree, so the largest
+free run is its root. apply/free only mark the groups they touch; the
+tree catches up on them, and their ancestors, when it is next read.
+the handle of an allocation is its first offset.
+*/
+
+#ifndef _BITMAP_ENGINE_H_
+#define _BITMAP_ENGINE_H_
+
+#include <cstdio>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "mem_engine.h"
+
+extern bool Mem_op_print;
+
+const int BITMAP_BLOCK_SIZE = 1; // one block per byte keeps file sizes exact
+
+class Bitmap_engine : public Memory_engine
+{
+private:
+    typedef unsigned long long word;
+    static constexpr int WORD_BITS = 64;
+    static constexpr word FULL = ~0ull;
+    static constexpr int GROUP_WORDS = 4; // used words under one run tree leaf
+    static constexpr int GROUP_BLOCKS = GROUP_WORDS * WORD_BITS;
+
+    struct Run // clear bits of used over a span of blocks
+    {
+        int prefix; // from the low end
+        int suffix; // from the high end
+        int best;
+    };
+
+    int block_size;
+    int block_cnt;
+    int word_cnt;
+    int free_blocks;
+    std::vector<word> used;
+    std::vector<word> start;
+    std::vector<word> finish;
+    int alloc_cnt;
+    int free_runs;
+    int leaf_cnt;          // run tree leaves, a power of two; leaf g covers group g
+    std::vector<Run> runs; // runs[1] covers the arena, node v has children 2v and 2v + 1
+    std::vector<int> dirty; // groups changed since the tree was read; their leaves hold best -1
+
+    // first index in [from, to) whose word differs from value, to if none
+    static int skip_words(const word* words, int from, const int& to, const word& value)
+    {
+#if defined(__AVX2__)
+        const __m256i v = _mm256_set1_epi64x((long long)value);
+        for (; from + 4 <= to; from += 4)
+        {
+            __m256i w = _mm256_loadu_si256((const __m256i*)(words + from));
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi64(w, v)) != -1) break;
+        }
+#elif defined(__SSE2__)
+        const __m128i v = _mm_set1_epi64x((long long)value);
+        for (; from + 2 <= to; from += 2)
+        {
+            __m128i w = _mm_loadu_si128((const __m128i*)(words + from));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(w, v)) != 0xFFFF) break;
+        }
+#endif
+        while (from < to && words[from] == value) from++;
+        return from;
+    }
+
+    // first block >= pos whose bit in map equals bit, block_cnt if none
+    int next_bit(const std::vector<word>& map, const int& pos, const bool& bit) const
+    {
+        if (pos >= block_cnt) return block_cnt;
+        int w = pos / WORD_BITS;
+        word bits = (bit ? map[w] : ~map[w]) & (FULL << (pos % WORD_BITS));
+        if (!bits)
+        {
+            w = skip_words(map.data(), w + 1, word_cnt, bit ? 0 : FULL);
+            if (w == word_cnt) return block_cnt;
+            bits = bit ? map[w] : ~map[w];
+        }
+        int res = w * WORD_BITS + lowest_bit64(bits);
+        return res < block_cnt ? res : block_cnt;
+    }
+
+    // last block <= pos whose bit in map is set, -1 if none
+    int prev_set(const std::vector<word>& map, const int& pos) const
+    {
+        int w = pos / WORD_BITS;
+        int shift = WORD_BITS - 1 - pos % WORD_BITS;
+        word bits = map[w] << shift >> shift;
+        while (!bits)
+        {
+            if (--w < 0) return -1;
+            bits = map[w];
+        }
+        return w * WORD_BITS + highest_bit64(bits);
+    }
+
+    static void set_range(std::vector<word>& map, int from, const int& cnt, const bool& bit)
+    {
+        int to = from + cnt;
+        while (from < to)
+        {
+            int w = from / WORD_BITS, off = from % WORD_BITS;
+            int len = WORD_BITS - off < to - from ? WORD_BITS - off : to - from;
+            word mask = (len == WORD_BITS ? FULL : ((1ull << len) - 1)) << off;
+            if (bit) map[w] |= mask;
+            else map[w] &= ~mask;
+            from += len;
+        }
+    }
+
+    static bool test(const std::vector<word>& map, const int& pos)
+    {
+        return (map[pos / WORD_BITS] >> (pos % WORD_BITS)) & 1;
+    }
+
+    bool clear_at(const int& pos) const
+    {
+        return pos >= 0 && pos < block_cnt && !test(used, pos);
+    }
+
+    static Run join(const Run& l, const Run& r, const int& l_span, const int& r_span)
+    {
+        Run res;
+        res.prefix = l.prefix == l_span ? l_span + r.prefix : l.prefix;
+        res.suffix = r.suffix == r_span ? r_span + l.suffix : r.suffix;
+        res.best = l.best > r.best ? l.best : r.best;
+        if (l.suffix + r.prefix > res.best) res.best = l.suffix + r.prefix;
+        return res;
+    }
+
+    static Run word_run(const word& w)
+    {
+        Run res;
+        if (!w)
+        {
+            res.prefix = res.suffix = res.best = WORD_BITS;
+            return res;
+        }
+        res.prefix = lowest_bit64(w);
+        res.suffix = WORD_BITS - 1 - highest_bit64(w);
+        res.best = res.prefix > res.suffix ? res.prefix : res.suffix;
+        word inner = ~(w | (w - 1)); // clear bits above the low run
+        if (res.suffix) inner &= FULL >> res.suffix; // and below the high one
+        for (int len = 1; inner; inner &= inner >> 1, len++) // each pass trims every run by one
+            if (len > res.best) res.best = len;
+        return res;
+    }
+
+    Run group_run(const int& g) const // words past the arena read as used
+    {
+        int w = g * GROUP_WORDS;
+        Run res = word_run(w < word_cnt ? used[w] : FULL);
+        for (int i = 1; i < GROUP_WORDS; i++)
+            res = join(res, word_run(w + i < word_cnt ? used[w + i] : FULL), i * WORD_BITS, WORD_BITS);
+        return res;
+    }
+
+    // blocks [from, to) of used changed
+    void mark_runs(const int& from, const int& to)
+    {
+        for (int g = from / GROUP_BLOCKS; g <= (to - 1) / GROUP_BLOCKS; g++)
+            if (~runs[leaf_cnt + g].best)
+            {
+                runs[leaf_cnt + g].best = -1;
+                dirty.push_back(g);
+            }
+    }
+
+    void refresh_runs()
+    {
+        for (int g : dirty) runs[leaf_cnt + g] = group_run(g);
+        for (int g : dirty)
+            for (int v = (leaf_cnt + g) / 2, span = GROUP_BLOCKS; v; v /= 2, span *= 2)
+                runs[v] = join(runs[2 * v], runs[2 * v + 1], span, span);
+        dirty.clear();
+    }
+
+    void build_runs()
+    {
+        leaf_cnt = 1;
+        while (leaf_cnt * GROUP_WORDS < word_cnt) leaf_cnt *= 2;
+        runs.resize(2 * leaf_cnt);
+        for (int g = 0; g < leaf_cnt; g++) runs[leaf_cnt + g] = group_run(g);
+        for (int lo = leaf_cnt / 2, span = GROUP_BLOCKS; lo; lo /= 2, span *= 2) // one level: nodes [lo, 2 lo)
+            for (int v = lo; v < 2 * lo; v++) runs[v] = join(runs[2 * v], runs[2 * v + 1], span, span);
+        dirty.clear();
+        dirty.reserve(leaf_cnt); // a group is listed once, so marking never allocates
+    }
+
+    int find_run(const int& n) const
+    {
+        int pos = 0;
+        while (true)
+        {
+            pos = next_bit(used, pos, false);
+            if (pos + n > block_cnt) return -1;
+            int end = next_bit(used, pos, true);
+            if (end - pos >= n) return pos;
+            pos = end + 1;
+        }
+    }
+
+public:
+    explicit Bitmap_engine(const int& storage_size, const int& _block_size = BITMAP_BLOCK_SIZE):
+        block_size(_block_size), block_cnt(storage_size / _block_size),
+        word_cnt((block_cnt + WORD_BITS - 1) / WORD_BITS), free_blocks(block_cnt),
+        used(word_cnt, 0), start(word_cnt, 0), finish(word_cnt, 0), alloc_cnt(0), free_runs(block_cnt ? 1 : 0)
+    {
+        if (block_cnt % WORD_BITS) // bits past the arena read as used, so no run crosses the end
+            used[word_cnt - 1] = FULL << (block_cnt % WORD_BITS);
+        build_runs();
+    }
+
+    int apply(const int& size, int& id)
+    {
+        id = -1;
+        if (size <= 0) return -1;
+        int n = (size + block_size - 1) / block_size;
+        if (n > free_blocks) return -1;
+        int pos = find_run(n);
+        if (!~pos) return -1;
+
+        set_range(used, pos, n, true);
+        set_range(start, pos, 1, true);
+        set_range(finish, pos + n - 1, 1, true);
+        free_blocks -= n;
+        alloc_cnt++;
+        free_runs += clear_at(pos - 1) + clear_at(pos + n) - 1;
+        mark_runs(pos, pos + n);
+
+        id = pos * block_size;
+        if (Mem_op_print)
+            printf("alloc: id: %d, range[%d, %d]\n", id, id, id + n * block_size - 1);
+        return id;
+    }
+
+    bool free(const int& id)
+    {
+        if (id < 0 || id % block_size || id / block_size >= block_cnt || !test(start, id / block_size))
+        {
+            fprintf(stderr, "error: cannot free.\n");
+            return false;
+        }
+        int pos = id / block_size;
+        int n = next_bit(finish, pos, true) - pos + 1;
+        set_range(used, pos, n, false);
+        set_range(start, pos, 1, false);
+        set_range(finish, pos + n - 1, 1, false);
+        free_blocks += n;
+        alloc_cnt--;
+        free_runs += 1 - clear_at(pos - 1) - clear_at(pos + n);
+        mark_runs(pos, pos + n);
+
+        if (Mem_op_print)
+            printf("free: id: %d, range[%d, %d] size: %d\n", id, id, id + n * block_size - 1, n * block_size);
+        return true;
+    }
+
+    bool resize(const int& id, const int& size)
+    {
+        if (id < 0 || id % block_size || id / block_size >= block_cnt || !test(start, id / block_size) || size <= 0)
+            return false;
+        int pos = id / block_size;
+        int n = next_bit(finish, pos, true) - pos + 1;
+        int m = (size + block_size - 1) / block_size;
+        if (m > n && next_bit(used, pos + n, true) < pos + m) return false;
+
+        set_range(finish, pos + n - 1, 1, false);
+        if (m > n) set_range(used, pos + n, m - n, true);
+        else set_range(used, pos + m, n - m, false);
+        set_range(finish, pos + m - 1, 1, true);
+        free_blocks -= m - n;
+        if (m > n)
+        {
+            free_runs += clear_at(pos + m) - 1;
+            mark_runs(pos + n, pos + m);
+        }
+        else if (m < n)
+        {
+            free_runs += 1 - clear_at(pos + n);
+            mark_runs(pos + m, pos + n);
+        }
+        return true;
+    }
+
+    bool grow(const int& new_size)
+    {
+        int new_cnt = new_size / block_size;
+        if (new_cnt <= block_cnt) return new_cnt == block_cnt;
+        if (!clear_at(block_cnt - 1)) free_runs++; // else the new blocks extend the last run
+        if (block_cnt % WORD_BITS) // clear the padding of the old last word
+            used[word_cnt - 1] &= ~(FULL << (block_cnt % WORD_BITS));
+        free_blocks += new_cnt - block_cnt;
+        block_cnt = new_cnt;
+        word_cnt = (block_cnt + WORD_BITS - 1) / WORD_BITS;
+        used.resize(word_cnt, 0);
+        start.resize(word_cnt, 0);
+        finish.resize(word_cnt, 0);
+        if (block_cnt % WORD_BITS)
+            used[word_cnt - 1] |= FULL << (block_cnt % WORD_BITS);
+        build_runs();
+        return true;
+    }
+
+    int get_id(const int& locate)
+    {
+        if (locate < 0 || locate / block_size >= block_cnt)
+            return -1;
+        int pos = locate / block_size;
+        if (!test(used, pos)) return -1;
+        return prev_set(start, pos) * block_size;
+    }
+
+    int free_space() const {return free_blocks * block_size;}
+    int largest_free() // longest run of clear bits
+    {
+        refresh_runs();
+        return runs[1].best * block_size;
+    }
+    int segments() const {return alloc_cnt + free_runs;}
+    int free_segments() const {return free_runs;}
+
+    void show()
+    {
+        printf("Memory Assignment: (bitmap, block %d byte(s))\n", block_size);
+        for (int pos = 0, end; pos < block_cnt; pos = end)
+        {
+            bool allocated = test(used, pos);
+            end = allocated ? next_bit(finish, pos, true) + 1 : next_bit(used, pos, true);
+            printf("segment %d: [%d, %d], size: %d, status: %s\n", pos * block_size,
+                   pos * block_size, end * block_size - 1, (end - pos) * block_size, allocated ? "allocated" : "free");
+        }
+    }
+};
+
+#endif /* _BITMAP_ENGINE_H_ */
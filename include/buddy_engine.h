@@ -0,0 +1,250 @@
+/*buddy_engine.h
+
+author: L1ttle-Q
+date: 2026-10-17
+
+binary buddy engine
+
+blocks are 2^order bytes and aligned to their size, so the buddy of
+the block at first is first ^ (1 << order): split and merge walk at most
+log2(arena) orders and never touch a neighbour list.
+a request is rounded up to a power of two; the rounding is counted as
+internal fragmentation.
+the arena (and every grown part of it) is covered by the largest
+aligned power of two blocks that fit; they merge like any other buddies.
+block metadata is kept per block start, keyed by first offset; the
+handle of a block is its first offset.
+*/
+
+#ifndef _BUDDY_ENGINE_H_
+#define _BUDDY_ENGINE_H_
+
+#include <cstdio>
+#include <unordered_map>
+
+#include "mem_engine.h"
+
+extern bool Mem_op_print;
+
+class Buddy_engine : public Memory_engine
+{
+public:
+    struct Buddy_stats
+    {
+        long long splits;
+        long long merges;
+        int allocated;   // bytes in allocated blocks
+        int requested;   // bytes asked for by those allocations
+        int internal_fragmentation() const {return allocated - requested;}
+
+        Buddy_stats(): splits(0), merges(0), allocated(0), requested(0) {}
+    };
+
+private:
+    static const int ORDER_CNT = 31;
+
+    struct Block
+    {
+        int order;
+        int requested; // size asked for, allocated blocks only
+        int free_prev;
+        int free_next;
+        bool used;
+    };
+
+    int storage_size;
+    int free_size;
+    int block_cnt; // blocks in the arena, allocated and free
+    int free_cnt;  // blocks in the free lists
+    std::unordered_map<int, Block> blocks; // block starts only
+    unsigned int order_bitmap; // bit k set iff heads[k] is non-empty
+    int heads[ORDER_CNT];
+    Buddy_stats stat;
+
+    Block* block_at(const int& first) // nullptr if no block starts there
+    {
+        std::unordered_map<int, Block>::iterator it = blocks.find(first);
+        return it == blocks.end() ? nullptr : &it->second;
+    }
+
+    static int order_of(const int& size) // smallest k with 2^k >= size
+    {
+        int k = highest_bit((unsigned int)size);
+        return (1 << k) < size ? k + 1 : k;
+    }
+
+    void insert_block(const int& first, const int& order)
+    {
+        Block& b = blocks[first];
+        b.order = order;
+        b.used = false;
+        b.free_prev = -1;
+        b.free_next = heads[order];
+        if (~heads[order]) blocks[heads[order]].free_prev = first;
+        heads[order] = first;
+        order_bitmap |= 1u << order;
+        free_cnt++;
+    }
+
+    void remove_block(const int& first)
+    {
+        Block& b = blocks[first];
+        if (~b.free_prev) blocks[b.free_prev].free_next = b.free_next;
+        else heads[b.order] = b.free_next;
+        if (~b.free_next) blocks[b.free_next].free_prev = b.free_prev;
+        if (!~heads[b.order]) order_bitmap &= ~(1u << b.order);
+        free_cnt--;
+    }
+
+    // give back the free block at first of the given order, merging with its buddies
+    void release(int first, int k)
+    {
+        while (k + 1 < ORDER_CNT)
+        {
+            int buddy = first ^ (1 << k);
+            if (buddy + (1 << k) > storage_size) break;
+            const Block* b = block_at(buddy);
+            if (!b || b->order != k || b->used) break;
+            remove_block(buddy);
+            if (Mem_op_print)
+                printf("merge: %d[%d, %d] %d[%d, %d]\n", first, first, first + (1 << k) - 1, buddy, buddy, buddy + (1 << k) - 1);
+            blocks.erase(first > buddy ? first : buddy);
+            first = first < buddy ? first : buddy;
+            k++;
+            block_cnt--;
+            stat.merges++;
+        }
+        insert_block(first, k);
+    }
+
+    // cover [first, end) with aligned power of two free blocks
+    void add_range(int first, const int& end)
+    {
+        while (first < end)
+        {
+            int k = highest_bit((unsigned int)(end - first));
+            if (first) k = k < lowest_bit((unsigned int)first) ? k : lowest_bit((unsigned int)first);
+            block_cnt++;
+            release(first, k);
+            first += 1 << k;
+        }
+    }
+
+public:
+    explicit Buddy_engine(const int& _storage_size):
+        storage_size(_storage_size), free_size(_storage_size), block_cnt(0), free_cnt(0), order_bitmap(0), stat()
+    {
+        for (int k = 0; k < ORDER_CNT; k++) heads[k] = -1;
+        add_range(0, storage_size);
+    }
+
+    int apply(const int& size, int& id)
+    {
+        id = -1;
+        if (size <= 0 || size > storage_size) return -1;
+        int k = order_of(size);
+        if (k >= ORDER_CNT) return -1;
+        unsigned int candidates = order_bitmap & (~0u << k);
+        if (!candidates) return -1;
+
+        int j = lowest_bit(candidates);
+        int first = heads[j];
+        remove_block(first);
+        while (j > k) // split, keep the lower half
+        {
+            j--;
+            insert_block(first + (1 << j), j);
+            block_cnt++;
+            stat.splits++;
+        }
+        Block& b = blocks[first];
+        b.order = k;
+        b.used = true;
+        b.requested = size;
+        free_size -= 1 << k;
+        stat.allocated += 1 << k;
+        stat.requested += size;
+
+        if (Mem_op_print)
+            printf("alloc: id: %d, range[%d, %d] (block %d)\n", first, first, first + size - 1, 1 << k);
+        id = first;
+        return first;
+    }
+
+    bool free(const int& id)
+    {
+        const Block* b = block_at(id);
+        if (!b || !b->used)
+        {
+            fprintf(stderr, "error: cannot free.\n");
+            return false;
+        }
+        int first = id;
+        int k = blocks[first].order;
+        free_size += 1 << k;
+        stat.allocated -= 1 << k;
+        stat.requested -= blocks[first].requested;
+        if (Mem_op_print)
+            printf("free: id: %d, range[%d, %d] size: %d\n", first, first, first + (1 << k) - 1, 1 << k);
+
+        blocks[first].used = false;
+        release(first, k);
+        return true;
+    }
+
+    bool resize(const int& id, const int& size) // only within the block already held
+    {
+        Block* b = block_at(id);
+        if (!b || !b->used) return false;
+        if (size <= 0 || size > (1 << b->order)) return false;
+        stat.requested += size - b->requested;
+        b->requested = size;
+        return true;
+    }
+
+    bool grow(const int& new_size)
+    {
+        if (new_size <= storage_size) return new_size == storage_size;
+        int first = storage_size;
+        free_size += new_size - storage_size;
+        storage_size = new_size;
+        add_range(first, new_size);
+        return true;
+    }
+
+    int get_id(const int& locate)
+    {
+        if (locate < 0 || locate >= storage_size)
+            return -1;
+        if (block_at(locate)) return locate;
+        for (int first = 0; first < storage_size; first += 1 << blocks[first].order) // interior offset
+            if (locate < first + (1 << blocks[first].order)) return first;
+        return -1;
+    }
+
+    int free_space() const {return free_size;}
+    int largest_free() {return order_bitmap ? 1 << highest_bit(order_bitmap) : 0;}
+    const Buddy_stats& stats() const {return stat;}
+
+    int segments() const {return block_cnt;}
+    int free_segments() const {return free_cnt;}
+
+    void show()
+    {
+        printf("Memory Assignment: (buddy)\n");
+        for (int first = 0; first < storage_size; first += 1 << blocks[first].order)
+        {
+            const Block& b = blocks[first];
+            if (b.used)
+                printf("segment %d: [%d, %d], size: %d, status: allocated (used %d)\n",
+                       first, first, first + (1 << b.order) - 1, 1 << b.order, b.requested);
+            else
+                printf("segment %d: [%d, %d], size: %d, status: free\n",
+                       first, first, first + (1 << b.order) - 1, 1 << b.order);
+        }
+        printf("splits: %lld, merges: %lld, internal fragmentation: %d/%d byte(s)\n",
+               stat.splits, stat.merges, stat.internal_fragmentation(), stat.allocated);
+    }
+};
+
+#endif /* _BUDDY_ENGINE_H_ */
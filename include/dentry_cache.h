@@ -0,0 +1,85 @@
+/*dentry_cache.h
+
+author: L1ttle-Q
+date: 2026-10-17
+
+bounded cache of directory entries: (folder, name) -> node
+
+a fixed, direct-mapped table; each slot keeps the folder, the node and the
+name hash, and a new entry simply evicts whatever shared its slot. a hit
+is confirmed against the owner (Nodes::is_child(folder, node, name)), so
+an entry left behind by a freed or recycled node can only miss, never
+answer wrongly; rename and unlink still drop their entry so the slot is
+not wasted.
+*/
+
+#ifndef _DENTRY_CACHE_H_
+#define _DENTRY_CACHE_H_
+
+#include <vector>
+
+#include "name_index.h"
+
+template <class Nodes>
+class Dentry_cache
+{
+private:
+    struct Entry
+    {
+        int folder; // -1 for an empty slot
+        int node;
+        unsigned int hash;
+    };
+
+    const Nodes* nodes;
+    std::vector<Entry> entries;
+    int shift; // 32 - log2(capacity)
+    long long hit_cnt, miss_cnt;
+
+    Entry& slot(const int& folder, const unsigned int& hash)
+    {
+        return entries[((hash ^ (unsigned int)folder) * 2654435761u) >> shift]; // top bits mix both
+    }
+
+public:
+    // capacity is rounded up to a power of two
+    Dentry_cache(const Nodes* _nodes, const int& capacity): nodes(_nodes), hit_cnt(0), miss_cnt(0)
+    {
+        int bits = 1;
+        while ((1 << bits) < capacity) bits++;
+        entries.assign(1 << bits, Entry{-1, -1, 0});
+        shift = 32 - bits;
+    }
+
+    // -1 on a miss; hash is name_hash(name)
+    int find(const int& folder, const char* name, const unsigned int& hash)
+    {
+        const Entry& e = slot(folder, hash);
+        if (e.folder == folder && e.hash == hash && nodes->is_child(folder, e.node, name))
+        {
+            hit_cnt++;
+            return e.node;
+        }
+        miss_cnt++;
+        return -1;
+    }
+
+    void insert(const int& folder, const unsigned int& hash, const int& node)
+    {
+        slot(folder, hash) = Entry{folder, node, hash};
+    }
+
+    void erase(const int& folder, const char* name)
+    {
+        const unsigned int hash = name_hash(name);
+        Entry& e = slot(folder, hash);
+        if (e.folder == folder && e.hash == hash) e.folder = -1;
+    }
+
+    int capacity() const {return entries.size();}
+    long long hits() const {return hit_cnt;}
+    long long misses() const {return miss_cnt;}
+    long long bytes() const {return entries.capacity() * sizeof(Entry);}
+};
+
+#endif /* _DENTRY_CACHE_H_ */
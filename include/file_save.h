@@ -16,36 +16,48 @@ fdcb -> [name;ctime;mtime;rwx]
 fcb -> (name;ctime;mtime;rwx)
 valid_ch -> any character except reserved
 reserved -> ;[]()"{}
+
+image (--image <path>): the arena bytes live in <path> itself, <path>.meta
+holds a flat binary table read back without parsing:
+header, nodes in preorder (a folder is followed by its child_cnt children),
+then every file's extents (first, size) in node order.
+both carry a generation; the image's moves ahead on the first write after
+a save, so a pair left apart by a crash is refused instead of misread
 */
 
 #ifndef _FILE_SAVE_H_
 #define _FILE_SAVE_H_
 
 class File_simulator;
-class folder_control_block;
 
 #include "file_simulator.h"
 
 class File_simulator_constructor
 {
 public:
-    void SetFolderAttr(File_simulator*, const char*, const time_t, const time_t, const int);
-    void SetFileAttr(File_simulator*, const char*, const time_t, const time_t, const int);
+    bool SetFolderAttr(File_simulator*, const char*, const time_t, const time_t, const int);
+    bool SetFileName(File_simulator*, const char*, const char*);
+    bool SetFileAttr(File_simulator*, const char*, const time_t, const time_t, const int);
     void Setrwx(File_simulator*, const int);
 
     void SaveSimulator(File_simulator*);
+    bool SaveImage(File_simulator*, const char*);
+    bool LoadImage(File_simulator*, const char*);
 private:
-    void SaveSimulator(folder_control_block*);
+    void SaveSimulator(const int&); // a folder inode
 };
 
 extern FILE* FILE_ISTREAM;
 extern FILE* FILE_OSTREAM;
 
 void SaveSimulator(File_simulator*);
+bool SaveImage(File_simulator*, const char*); // path of the mapped arena
+bool LoadImage(File_simulator*, const char*); // should be a new simulator
 
 bool Reserved(const char&);
 bool Reserved(const char*);
 bool valid_ch(const char&);
+bool valid_name(const char*);
 bool S(File_simulator*); // should be a new simulator
 
 #endif /* _FILE_SAVE_H_ */
\ No newline at end of file
@@ -11,29 +11,39 @@ tree // current dir
 treeall  // root dir
 pwd
 ls
-create
-write <filename> <data>
-read <filename>
-mkdir <foldername>
-delete <filename>
-deldir <foldername>
-append <filename> <data>
-cp <filename> <filename>
-rename <filename> <filename>
-chmod <filename> <rwx>
-cd <foldername>
+create <path>
+write <path> <data>
+read <path>
+mkdir <path>
+delete <path>
+deldir <path>
+append <path> <data>
+cp <path> <path>
+rename <path> <path> // moves the node when the folder differs
+chmod <path> <rwx>
+cd <path>
+defrag
+memstat
+sync // write the image metadata now (with --image)
 exit
 
+a path is a name, or names joined by '/' (a/b/c.txt); one starting with
+'/' is taken from the root, others from the current folder. every folder
+passed through needs x.
+
 */
 
 #ifndef _FILE_SIMULATOR_H_
 #define _FILE_SIMULATOR_H_
 
+#include <cstdint>
 #include <cstring>
 #include <ctime>
+#include <vector>
 #include <iostream>
 
 #include "mem_simulator.h"
+#include "inode_table.h"
 #include "file_save.h"
 
 #define min(a, b) ((a) > (b) ? (b) : (a))
@@ -41,7 +51,11 @@ exit
 #define W 0200
 #define X 0100
 
-const int MAX_NAME_LENGTH = 64;
+extern int arena_size;  // arena bytes at startup
+extern int arena_limit; // the arena may grow up to this many bytes
+extern const char* arena_image; // file mapped as the arena, nullptr for an anonymous arena
+extern int arena_zones;         // zone boundary in bytes (see Memory_simulator::set_zones), 0 for none
+extern Trace_recorder* mem_trace; // allocator calls are recorded here when set
 
 namespace file_simulator_operation
 {
@@ -55,249 +69,334 @@ namespace file_simulator_operation
         Append, Cp, Rename,
         Chmod, Cd,
         Export, Import,
+        Defrag, Memstat, Sync,
         Exit
     };
 }
 
-class basic_block;
-class file_control_block;
-class folder_control_block;
 class File_simulator;
 
 #ifdef _FILE_SAVE_H_
 class File_simulator_constructor;
 #endif /* _FILE_SAVE_H_ */
 
-class basic_block
+// files and folders are inodes (see inode_table.h), addressed by index
+class File_simulator
 {
-protected:
-    char name[MAX_NAME_LENGTH];
-    time_t ctime, mtime;
-    int rwx;
+private:
+    static Memory_simulator* mem;
+    static char* MEMORY;
+    static Inode_table* inodes; // shared like the arena; every simulator has its own root in it
+    static bool image_clean;    // no arena byte changed since the image's .meta was read or written
 
-public:
-    basic_block* sibling;
+    int root_folder;
+    int now;
 
-    virtual const int Size() const {return 0;};
-    virtual ~basic_block() {}
+#ifdef _FILE_SAVE_H_
+    friend File_simulator_constructor;
+#endif
 
-    basic_block(const char* _name, const time_t _ctime, const int _rwx, basic_block* _sibling)
-    {
-        strncpy(name, _name, MAX_NAME_LENGTH - 1);
-        name[MAX_NAME_LENGTH - 1] = '\0';
-        ctime = mtime = _ctime;
-        rwx = _rwx;
-        sibling = _sibling;
-    }
-    const char* get_name() const {return name;}
-    void modify_name(const char* _name)
+    // a segment's owner is its extent record, shifted so record 0 is not nullptr
+    static void* extent_owner(const int& e) {return reinterpret_cast<void*>((intptr_t)e + 1);}
+
+    static void relocate_file(void* owner, const int&, const int& first)
     {
-        strncpy(name, _name, MAX_NAME_LENGTH - 1);
-        name[MAX_NAME_LENGTH - 1] = '\0';
+        inodes->extent((int)reinterpret_cast<intptr_t>(owner) - 1).first = first;
     }
-    time_t get_ctime() const {return ctime;}
-    time_t get_mtime() const {return mtime;}
-
-    void modify_ctime(const time_t _ctime) {ctime = _ctime;}
-    void modify_mtime(const time_t _mtime) {mtime = _mtime;}
-    const int get_rwx() const {return rwx;}
-    void modify_rwx(const int _rwx) {rwx = _rwx;}
-
-};
 
-class folder_control_block : public basic_block
-{
-public:
-    folder_control_block* parent;
-    basic_block* ch;
-
-    folder_control_block(const char* _name, const time_t _ctime, const int _rwx,
-                         folder_control_block* _parent, basic_block* _sibling):
-                         basic_block(_name, _ctime, _rwx, _sibling)
+    // the first arena write after a save moves the image generation past its
+    // .meta, so a crash before the next save is refused on load, not misread
+    static void touch_image()
     {
-        parent = _parent;
-        ch = nullptr;
+        if (!image_clean) return;
+        image_clean = false;
+        if (!arena_set_generation(arena_file_generation() + 1))
+            fprintf(stderr, "error: cannot stamp image %s.\n", arena_image);
     }
 
-    ~folder_control_block()
+    // "/a/b" for folder p, "" for the root
+    void path_of(const int& p, char* path, const int& size)
     {
-        basic_block* p = ch;
-        basic_block* tmp;
-        while (p)
-        {
-            tmp = p;
-            p = p->sibling;
-            delete tmp;
-        }
+        std::vector<int> chain;
+        for (int f = p; f != root_folder; f = (*inodes)[f].parent) chain.push_back(f);
+        int len = 0;
+        path[0] = '\0';
+        for (int k = (int)chain.size() - 1; k >= 0 && len < size; k--)
+            len += snprintf(path + len, size - len, "/%s", inodes->name(chain[k]));
     }
 
-    const int Size() const
+    void show_tree(const int& p, int depth)
     {
-        int res = 0;
-        basic_block* p = ch;
-        while (p)
+        printf("%s/\n", inodes->name(p));
+        for (int ch = (*inodes)[p].folder.child; ~ch; ch = (*inodes)[ch].sibling)
         {
-            res += p->Size();
-            p = p->sibling;
+            for (int i = 1; i <= depth; i++) printf("|  ");
+            printf("|--");
+
+            if ((*inodes)[ch].is_folder())
+                show_tree(ch, depth + 1);
+            else
+                printf("%s\n", inodes->name(ch));
         }
-        return res;
     }
-};
-
-class file_control_block : public basic_block
-{
-private:
-    int pfile;
-    int size;
-
-    friend File_simulator;
-#ifdef _FILE_SAVE_H_
-    friend File_simulator_constructor;
-#endif
-public:
-    folder_control_block* parent;
 
-    file_control_block(const char* _name, const time_t _ctime, const int _rwx, const int _size,
-                       const int _pfile, folder_control_block* _parent, basic_block* _sibling):
-                       basic_block(_name, _ctime, _rwx, _sibling)
+    bool is_ancestor(const int& a, const int& p)
     {
-        parent = _parent;
-        size = _size;
-        pfile = _pfile;
+        for (int f = p; ~f; f = (*inodes)[f].parent)
+            if (f == a) return true;
+        return false;
     }
 
-    ~file_control_block();
-
-    const char* Type() // check file type by postfix
+    // the child name of folder p, where "." and ".." stay inside this simulator's root
+    int child(const int& p, const char* name)
     {
-        int len = strlen(name);
-        for (int i = len - 2; i >= 0; i--)
-            if (name[i] == '.')
-                return (name + i + 1);
-        return "FILE";
+        if (!*name || !strcmp(name, ".")) return p;
+        if (!strcmp(name, "..")) return p == root_folder ? p : (*inodes)[p].parent;
+        return inodes->lookup(p, name);
     }
-    const int Size() const
+
+    // the folder holding the last component of path, which is copied to leaf
+    // ("" for "/"); paths starting with '/' are taken from the root, others from
+    // now. -1 when a folder on the way is missing or not searchable
+    int walk(const char* path, char* leaf)
     {
-        return this->size;
-    }
-};
+        int p = *path == '/' ? root_folder : now;
+        while (true)
+        {
+            while (*path == '/') path++;
+            int len = strcspn(path, "/");
+            const char* next = path + len;
+            while (*next == '/') next++;
 
-class File_simulator
-{
-private:
-    folder_control_block root_folder;
-    static Memory_simulator* mem;
-    static char* MEMORY;
+            len = min(len, MAX_NAME_LENGTH - 1);
+            memcpy(leaf, path, len);
+            leaf[len] = '\0';
+            if (!*next) return p;
 
-    folder_control_block* now;
+            int ch = child(p, leaf);
+            if (!~ch)
+            {
+                fprintf(stderr, "error: no such folder %s.\n", leaf);
+                return -1;
+            }
+            if (!(*inodes)[ch].is_folder())
+            {
+                fprintf(stderr, "error: %s is a file.\n", leaf);
+                return -1;
+            }
+            if (!((*inodes)[ch].rwx & X))
+            {
+                fprintf(stderr, "Permission denied.\n");
+                return -1;
+            }
+            p = ch;
+            path = next;
+        }
+    }
 
-    friend folder_control_block;
-    friend file_control_block;
-#ifdef _FILE_SAVE_H_
-    friend File_simulator_constructor;
-#endif
+    // -1 when nothing is at path; what names the missing kind in the message
+    int find(const char* path, const char* what)
+    {
+        char leaf[MAX_NAME_LENGTH];
+        int p = walk(path, leaf);
+        if (!~p) return -1;
+        int ch = child(p, leaf);
+        if (!~ch) fprintf(stderr, "error: no such %s.\n", what);
+        return ch;
+    }
 
-    char* recursive_parent_name(folder_control_block* p)
+    int find_file(const char* path)
     {
-        static char path[1024];
-        if (p == &root_folder) {path[0] = '\0'; return path;}
-        char* p_path = recursive_parent_name(p->parent);
-        snprintf(path, sizeof(path), "%s/%s", p_path, p->get_name());
-        return path;
+        int ch = find(path, "file");
+        if (~ch && !(*inodes)[ch].is_file())
+        {
+            fprintf(stderr, "error: %s is a folder.\n", path);
+            return -1;
+        }
+        return ch;
     }
 
-    void show_tree(folder_control_block* p, int depth)
+    int find_folder(const char* path)
     {
-        printf("%s/\n", p->get_name());
-        basic_block* ch = p->ch;
-        while (ch)
+        int ch = find(path, "folder");
+        if (~ch && !(*inodes)[ch].is_folder())
         {
-            for (int i = 1; i <= depth; i++) printf("|  ");
-            printf("|--");
-            
-            if (dynamic_cast<folder_control_block*>(ch))
-                show_tree(dynamic_cast<folder_control_block*>(ch), depth + 1);
-            else
-                printf("%s\n", ch->get_name());
-            ch = ch->sibling;
+            fprintf(stderr, "error: %s is a file.\n", path);
+            return -1;
         }
+        return ch;
     }
 
-    bool check_name(const char* name)
+    // the writable folder to hold a new node at path, whose name is copied
+    // to leaf; -1 when the name is invalid or taken
+    int find_new(const char* path, char* leaf)
     {
-        basic_block* ch = now->ch;
-        while (ch)
+        int p = walk(path, leaf);
+        if (!~p) return -1;
+        if (!((*inodes)[p].rwx & W))
         {
-            if (!strcmp(ch->get_name(), name)) return true;
-            ch = ch->sibling;
+            fprintf(stderr, "Permission denied.\n");
+            return -1;
         }
-        return false;
+        if (!*leaf || !strcmp(leaf, ".") || !strcmp(leaf, ".."))
+        {
+            fprintf(stderr, "error: invalid name %s.\n", path);
+            return -1;
+        }
+        if (~inodes->lookup(p, leaf))
+        {
+            fprintf(stderr, "error: file/folder %s exists.\n", leaf);
+            return -1;
+        }
+        return p;
     }
 
-    file_control_block* find_file(const char* name, folder_control_block* p)
+    // a new empty file at path, -1 on failure
+    int create_file(const char* path)
     {
-        basic_block* ch = p->ch;
-        file_control_block* dst_file = nullptr;
-        while (ch)
+        char leaf[MAX_NAME_LENGTH];
+        int p = find_new(path, leaf);
+        if (!~p) return -1;
+
+        int new_file = inodes->create(leaf, kind_file, std::time(nullptr), 0777);
+        if (!allocate(new_file, 1))
         {
-            if (!strcmp(ch->get_name(), name))
+            fprintf(stderr, "error: no available space.\n");
+            erase_tree(new_file);
+            return -1;
+        }
+        (*inodes)[new_file].size = 1;
+        MEMORY[inodes->extent((*inodes)[new_file].file.extent).first] = '\0';
+        inodes->add_child(p, new_file);
+        (*inodes)[p].mtime = std::time(nullptr);
+        return new_file;
+    }
+
+    // claim size more bytes for p as few extents as possible, never compacting;
+    // on failure nothing is claimed
+    bool allocate(const int& p, int size)
+    {
+        touch_image(); // apply may compact
+        if (mem->free_space() < size) mem->expand_for(size);
+        if (mem->free_space() < size) return false;
+        const int origin = (*inodes)[p].file.extent_cnt;
+        while (size > 0)
+        {
+            int first, id;
+            int part = min(size, mem->largest_free());
+            if (part <= 0 || (first = mem->apply(part, id)) == -1)
             {
-                if ((dst_file = dynamic_cast<file_control_block*>(ch)) == nullptr)
-                {
-                    fprintf(stderr, "error: %s is a folder.\n", name);
-                    return nullptr;
-                }
-                return dst_file;
+                std::vector<int> ids;
+                inodes->truncate_extents(p, origin, ids);
+                for (int i : ids) mem->free(i);
+                return false;
             }
-            ch = ch->sibling;
+            mem->set_owner(id, extent_owner(inodes->add_extent(p, first, id, part)));
+            size -= part;
         }
-        fprintf(stderr, "error: no such file.\n");
-        return nullptr;
+        return true;
+    }
+
+    // free p, which is unlinked, and everything below it; the content of
+    // every file goes back in one batched free
+    void erase_tree(const int& p)
+    {
+        std::vector<int> ids;
+        inodes->erase(p, ids);
+        mem->free_batch(ids);
+    }
+
+    void release(const int& p)
+    {
+        std::vector<int> ids;
+        inodes->truncate_extents(p, 0, ids);
+        for (int id : ids) mem->free(id);
+        (*inodes)[p].size = 0;
     }
 
-    folder_control_block* find_folder(const char* name, folder_control_block* p)
+    // copy len bytes of data into p's extents, starting at byte offset of the file
+    void put_bytes(const int& p, int offset, const char* data, int len)
     {
-        basic_block* ch = p->ch;
-        folder_control_block* dst_folder = nullptr;
-        while (ch)
+        touch_image();
+        for (int k = (*inodes)[p].file.extent; ~k && len > 0; k = inodes->extent(k).next)
         {
-            if (!strcmp(ch->get_name(), name))
-            {
-                if ((dst_folder = dynamic_cast<folder_control_block*>(ch)) == nullptr)
-                {
-                    fprintf(stderr, "error: %s is a file.\n", name);
-                    return nullptr;
-                }
-                return dst_folder;
-            }
-            ch = ch->sibling;
+            const Extent_record& e = inodes->extent(k);
+            if (offset >= e.size) {offset -= e.size; continue;}
+            int part = min(len, e.size - offset);
+            memcpy(MEMORY + e.first + offset, data, part * sizeof(char));
+            data += part; len -= part;
+            offset = 0;
         }
-        fprintf(stderr, "error: no such folder.\n");
-        return nullptr;
     }
 
-    basic_block* find_prev(const basic_block* p, folder_control_block* parent)
+    void get_bytes(const int& p, char* data)
     {
-        basic_block* tmp = parent->ch;
-        while (tmp->sibling)
+        for (int k = (*inodes)[p].file.extent; ~k; k = inodes->extent(k).next)
         {
-            if (tmp->sibling == p) return tmp;
-            tmp = tmp->sibling;
+            const Extent_record& e = inodes->extent(k);
+            memcpy(data, MEMORY + e.first, e.size * sizeof(char));
+            data += e.size;
         }
-        return nullptr;
+    }
+
+    // replace p's content; the old content is kept if there is no room
+    bool store(const int& p, const char* data, const int& data_size)
+    {
+        int last_size = (*inodes)[p].size;
+        char* last_data = new char[last_size];
+        get_bytes(p, last_data);
+
+        release(p);
+        if (!allocate(p, data_size))
+        {
+            int size = last_size;
+            if (allocate(p, size))
+            {
+                put_bytes(p, 0, last_data, size);
+                fprintf(stderr, "error: no available space.(file has been recovered)\n");
+            }
+            else // the freed bytes did not fit back: keep the one empty byte a new file has
+            {
+                size = allocate(p, 1) ? 1 : 0;
+                if (size) MEMORY[inodes->extent((*inodes)[p].file.extent).first] = '\0';
+                fprintf(stderr, "error: no available space.(file content lost)\n");
+            }
+            (*inodes)[p].size = size;
+            inodes->account((*inodes)[p].parent, size - last_size, 0);
+            delete[] last_data;
+            return false;
+        }
+        put_bytes(p, 0, data, data_size);
+        (*inodes)[p].size = data_size;
+        inodes->account((*inodes)[p].parent, data_size - last_size, 0);
+        delete[] last_data;
+        return true;
     }
 
 public:
-    File_simulator() : root_folder("", std::time(nullptr), 0777, nullptr, nullptr)
+    File_simulator()
     {
         if (!mem)
         {
-            mem = new Memory_simulator();
-            MEMORY = new char[MEMORY_STORAGY];
-        }
-        now = &root_folder;
+            int size = arena_size;
+            if (arena_image && !(MEMORY = arena_map_file(arena_image, size)))
+            {
+                fprintf(stderr, "error: cannot map image %s.(anonymous arena used)\n", arena_image);
+                arena_image = nullptr;
+                size = arena_size;
+            }
+            if (!MEMORY) MEMORY = arena_alloc(size);
+            mem = new Memory_simulator(size);
+            mem->bind_storage(&MEMORY, relocate_file, arena_limit);
+            mem->set_trace(mem_trace);
+            mem->set_zones(arena_zones);
+            inodes = new Inode_table();
+        }
+        root_folder = now = inodes->create("", kind_folder, std::time(nullptr), 0777);
     }
-    ~File_simulator() = default;
+    File_simulator(const File_simulator&) = delete;
+    File_simulator& operator = (const File_simulator&) = delete;
+    ~File_simulator() {erase_tree(root_folder);}
 
     void show_tree()
     {
@@ -306,338 +405,292 @@ public:
 
     void pwd()
     {
-        printf("%s/\n", recursive_parent_name(now));
+        static char path[1024];
+        path_of(now, path, sizeof(path));
+        printf("%s/\n", path);
     }
 
     void ls()
     {
-        if (!(now->get_rwx() & R))
+        if (!((*inodes)[now].rwx & R))
         {
             fprintf(stderr, "Permission denied.\n");
             return ;
         }
 
-        printf("Total size: %d\n", now->Size());
-        basic_block* ch = now->ch;
-        while (ch)
+        printf("Total size: %d, files: %d\n", (*inodes)[now].size, inodes->files(now));
+        for (int ch = (*inodes)[now].folder.child; ~ch; ch = (*inodes)[ch].sibling)
         {
-            if (dynamic_cast<folder_control_block*>(ch))
+            const Inode& node = (*inodes)[ch];
+            if (node.is_folder())
                 printf("d");
             else printf("-");
-            printf("%c%c%c. ", ch->get_rwx() & R ? 'r' : '-',
-                   ch->get_rwx() & W ? 'w' : '-', ch->get_rwx() & X ? 'x' : '-');
-            printf("%s ", ch->get_name());
+            printf("%c%c%c. ", node.rwx & R ? 'r' : '-',
+                   node.rwx & W ? 'w' : '-', node.rwx & X ? 'x' : '-');
+            printf("%s ", inodes->name(ch));
 
-            time_t ctime = ch->get_ctime(), mtime = ch->get_mtime();
+            time_t ctime = node.ctime, mtime = node.mtime;
             tm c_tm = *std::localtime(&ctime); tm m_tm = *std::localtime(&mtime);
             static char c_buf[50], m_buf[50];
             std::strftime(c_buf, sizeof(c_buf), "%Y-%m-%d %H:%M:%S", &c_tm);
             std::strftime(m_buf, sizeof(m_buf), "%Y-%m-%d %H:%M:%S", &m_tm);
             printf("ctime: %s | mtime: %s", c_buf, m_buf);
             printf("\n");
-            ch = ch->sibling;
         }
         printf("\n");
     }
 
-    bool create(const char* name)
+    bool create(const char* path)
     {
-        if (!(now->get_rwx() & W))
-        {
-            fprintf(stderr, "Permission denied.\n");
-            return false;
-        }
-
-        if (check_name(name))
-        {
-            fprintf(stderr, "error: file/folder %s exists.\n", name);
-            return false;
-        }
-
-        int size = 1;
-        int pfile = mem->apply(1);
-
-        if (pfile == -1)
-        {
-            fprintf(stderr, "error: no available space.\n");
-            return false;
-        }
-
-        MEMORY[pfile] = '\0';
-        basic_block* tmp = now->ch;
-        now->ch = new file_control_block(name, std::time(nullptr), 0777, size, pfile, now, tmp);
-        now->modify_mtime(std::time(nullptr));
-        return true;
+        return create_file(path) != -1;
     }
 
-    bool write(const char* name, const char* data)
+    bool write(const char* path, const char* data)
     {
-        file_control_block* dst_file = find_file(name, now);
-        if (!dst_file) return false;
+        int dst_file = find_file(path);
+        if (!~dst_file) return false;
 
-        if (!(dst_file->get_rwx() & W))
+        if (!((*inodes)[dst_file].rwx & W))
         {
             fprintf(stderr, "Permission denied.\n");
             return false;
         }
 
-        int last_locate = dst_file->pfile;
-        mem->free_by_locate(dst_file->pfile);
         int data_size = strlen(data);
         if (!data_size) data_size++;
-        if ((dst_file->pfile = mem->apply(data_size)) == -1)
-        {
-            dst_file->pfile = mem->apply(dst_file->size);
-            memcpy(MEMORY + dst_file->pfile, MEMORY + last_locate, dst_file->size * sizeof(char));
-            fprintf(stderr, "error: no available space.(file has been recovered)\n");
-            return false;
-        }
-        dst_file->size = data_size;
-        memcpy(MEMORY + dst_file->pfile, data, data_size * sizeof(char));
-        dst_file->modify_mtime(std::time(nullptr));
-        now->modify_mtime(dst_file->get_mtime());
+        if (!store(dst_file, data, data_size)) return false;
+        (*inodes)[dst_file].mtime = std::time(nullptr);
+        (*inodes)[(*inodes)[dst_file].parent].mtime = (*inodes)[dst_file].mtime;
         return true;
     }
 
-    bool read(const char* name)
+    bool read(const char* path)
     {
-        file_control_block* dst_file = find_file(name, now);
-        if (!dst_file) return false;
+        int dst_file = find_file(path);
+        if (!~dst_file) return false;
 
-        if (!(dst_file->get_rwx() & R))
+        if (!((*inodes)[dst_file].rwx & R))
         {
             fprintf(stderr, "Permission denied.\n");
             return false;
         }
 
-        char* out_str = MEMORY + dst_file->pfile;
-        fwrite(out_str, 1, dst_file->size, stdout);
+        for (int k = (*inodes)[dst_file].file.extent; ~k; k = inodes->extent(k).next)
+            fwrite(MEMORY + inodes->extent(k).first, 1, inodes->extent(k).size, stdout);
         printf("\n");
         return true;
     }
 
-    bool mkdir(const char* name)
+    bool mkdir(const char* path)
     {
-        if (!(now->get_rwx() & W))
-        {
-            fprintf(stderr, "Permission denied.\n");
-            return false;
-        }
-        if (check_name(name))
-        {
-            fprintf(stderr, "error: file/folder %s exists.\n", name);
-            return false;
-        }
-        basic_block* tmp = now->ch;
-        now->ch = new folder_control_block(name, std::time(nullptr), 0777, now, tmp);
-        now->modify_mtime(std::time(nullptr));
+        char leaf[MAX_NAME_LENGTH];
+        int p = find_new(path, leaf);
+        if (!~p) return false;
+        inodes->add_child(p, inodes->create(leaf, kind_folder, std::time(nullptr), 0777));
+        (*inodes)[p].mtime = std::time(nullptr);
         return true;
     }
 
-    bool delete_file(const char* name)
+    bool delete_file(const char* path)
     {
-        if (!(now->get_rwx() & W))
+        int dst_file = find(path, "file");
+        if (!~dst_file) return false;
+        if (!(*inodes)[dst_file].is_file())
         {
-            fprintf(stderr, "Permission denied.\n");
+            fprintf(stderr, "error: %s is a folder.\n", path);
+            fprintf(stderr, "tip: use \"deldir <foldername>\" instead.\n");
             return false;
         }
-        if (!check_name(name))
+        int p = (*inodes)[dst_file].parent;
+        if (!((*inodes)[p].rwx & W))
         {
-            fprintf(stderr, "error: no such file.\n");
-            return false;
-        }
-        file_control_block* dst_file = nullptr;
-        if ((dst_file = find_file(name, now)) == nullptr)
-        {
-            fprintf(stderr, "tip: use \"deldir <foldername>\" instead.\n", name);
+            fprintf(stderr, "Permission denied.\n");
             return false;
         }
 
-        basic_block* prev_block = find_prev(dst_file, now);
-        if (!prev_block)
-            now->ch = dst_file->sibling;
-        else
-            prev_block->sibling = dst_file->sibling;
-
-        now->modify_mtime(std::time(nullptr));
-        delete dst_file;
+        inodes->remove_child(dst_file);
+        (*inodes)[p].mtime = std::time(nullptr);
+        erase_tree(dst_file);
         return true;
     }
 
-    bool delete_folder(const char* name)
+    bool delete_folder(const char* path)
     {
-        if (!(now->get_rwx() & W))
+        int dst_folder = find(path, "folder");
+        if (!~dst_folder) return false;
+        if (!(*inodes)[dst_folder].is_folder())
         {
-            fprintf(stderr, "Permission denied.\n");
+            fprintf(stderr, "error: %s is a file.\n", path);
+            fprintf(stderr, "tip: use \"delete <filename>\" instead.\n");
             return false;
         }
-        if (!check_name(name))
+        if (is_ancestor(dst_folder, now))
         {
-            fprintf(stderr, "error: no such folder.\n");
+            fprintf(stderr, "error: %s holds the current folder.\n", path);
             return false;
         }
-        folder_control_block* dst_folder = nullptr;
-        if ((dst_folder = find_folder(name, now)) == nullptr)
+        if (!((*inodes)[(*inodes)[dst_folder].parent].rwx & W))
         {
-            fprintf(stderr, "tip: use \"delete <filename>\" instead.\n", name);
+            fprintf(stderr, "Permission denied.\n");
             return false;
         }
 
-        basic_block* prev_block = find_prev(dst_folder, now);
-        if (!prev_block)
-            now->ch = dst_folder->sibling;
-        else
-            prev_block->sibling = dst_folder->sibling;
-
-        delete dst_folder;
+        inodes->remove_child(dst_folder);
+        erase_tree(dst_folder);
         return true;
     }
 
-    bool append(const char* name, const char* append_data)
+    bool append(const char* path, const char* append_data)
     {
-        file_control_block* dst_file = find_file(name, now);
-        if (!dst_file) return false;
-        if (!(dst_file->get_rwx() & W))
+        int dst_file = find_file(path);
+        if (!~dst_file) return false;
+        if (!((*inodes)[dst_file].rwx & W))
         {
             fprintf(stderr, "Permission denied.\n");
             return false;
         }
 
-        int last_locate = dst_file->pfile;
-        mem->free_by_locate(dst_file->pfile);
-
         int len_append = strlen(append_data);
-        int data_size = dst_file->size + len_append;
-        if ((dst_file->pfile = mem->apply(data_size)) == -1)
+        const int last = (*inodes)[dst_file].file.last_extent;
+        if (~last && mem->resize(inodes->extent(last).id, inodes->extent(last).size + len_append)) // grown in place
+            inodes->extent(last).size += len_append;
+        else if (!allocate(dst_file, len_append)) // new extent(s) for the appended bytes only
         {
-            dst_file->pfile = mem->apply(dst_file->size);
-            memcpy(MEMORY + dst_file->pfile, MEMORY + last_locate, dst_file->size * sizeof(char));
-            fprintf(stderr, "error: no available space.(file has been recovered)\n");
+            fprintf(stderr, "error: no available space.\n");
             return false;
         }
-        char* data = new char[data_size];
-        memcpy(data, MEMORY + last_locate, dst_file->size * sizeof(char));
-        memcpy(data + dst_file->size, append_data, len_append * sizeof(char));
-
-        dst_file->size = data_size;
-        memcpy(MEMORY + dst_file->pfile, data, data_size * sizeof(char));
-        dst_file->modify_mtime(std::time(nullptr));
-        now->modify_mtime(dst_file->get_mtime());
-
-        delete[] data;
+        put_bytes(dst_file, (*inodes)[dst_file].size, append_data, len_append);
+        (*inodes)[dst_file].size += len_append;
+        const int p = (*inodes)[dst_file].parent;
+        inodes->account(p, len_append, 0);
+        (*inodes)[dst_file].mtime = std::time(nullptr);
+        (*inodes)[p].mtime = (*inodes)[dst_file].mtime;
         return true;
     }
 
     bool cp(const char* src, const char* dst)
     {
-        if (!(now->get_rwx() & W))
-        {
-            fprintf(stderr, "Permission denied.\n");
-            return false;
-        }
-
-        file_control_block* src_file = find_file(src, now);
-        if (!src_file) return false;
-        if (!(src_file->get_rwx() & R))
+        int src_file = find_file(src);
+        if (!~src_file) return false;
+        if (!((*inodes)[src_file].rwx & R))
         {
             fprintf(stderr, "Permission denied.\n");
             return false;
         }
 
-        if (check_name(dst))
-        {
-            fprintf(stderr, "error: duplicate file/folder name.\n");
-            return false;
-        }
-
-        create(dst);
-        char *tmp_s = new char[src_file->size];
-        memcpy(tmp_s, MEMORY + src_file->pfile, src_file->size * sizeof(char));
-        bool res = write(dst, tmp_s);
+        int dst_file = create_file(dst);
+        if (!~dst_file) return false;
+        int size = (*inodes)[src_file].size;
+        char *tmp_s = new char[size];
+        get_bytes(src_file, tmp_s);
+        bool res = store(dst_file, tmp_s, size);
         delete[] tmp_s;
         return res;
     }
 
-    bool rename(const char* old_name, const char* new_name)
+    // a new path in another folder moves the node there
+    bool rename(const char* old_path, const char* new_path)
     {
-        if (!(now->get_rwx() & W))
-        {
-            fprintf(stderr, "Permission denied.\n");
-            return false;
-        }
-        if (!check_name(old_name))
+        int ch = find(old_path, "file/folder");
+        if (!~ch) return false;
+        if (ch == root_folder)
         {
-            fprintf(stderr, "error: no such file/folder.\n");
+            fprintf(stderr, "error: root folder can not be renamed.\n");
             return false;
         }
-        if (check_name(new_name))
+        const int from = (*inodes)[ch].parent;
+        if (!((*inodes)[from].rwx & W))
         {
-            fprintf(stderr, "error: duplicate file/folder name.\n");
+            fprintf(stderr, "Permission denied.\n");
             return false;
         }
-        basic_block* ch = now->ch;
-        while (ch)
+        char leaf[MAX_NAME_LENGTH];
+        int to = find_new(new_path, leaf);
+        if (!~to) return false;
+
+        if (to == from) inodes->rename(ch, leaf);
+        else
         {
-            if (!strcmp(ch->get_name(), old_name))
+            if (is_ancestor(ch, to))
             {
-                ch->modify_name(new_name);
-                ch->modify_mtime(std::time(nullptr));
-                now->modify_mtime(ch->get_mtime());
-                return true;
+                fprintf(stderr, "error: cannot move %s into itself.\n", old_path);
+                return false;
             }
-            ch = ch->sibling;
+            inodes->remove_child(ch);
+            inodes->rename(ch, leaf);
+            inodes->add_child(to, ch);
         }
-        return false;
+        (*inodes)[ch].mtime = std::time(nullptr);
+        (*inodes)[from].mtime = (*inodes)[to].mtime = (*inodes)[ch].mtime;
+        return true;
     }
 
-    bool chmod(const char* name, const int& _rwx)
+    bool chmod(const char* path, const int& _rwx)
     {
-        if (!check_name(name))
-        {
-            fprintf(stderr, "error: no such file/folder.\n");
-            return false;
-        }
-        basic_block* ch = now->ch;
-        while (ch)
-        {
-            if (!strcmp(ch->get_name(), name))
-            {
-                ch->modify_rwx(_rwx);
-                return true;
-            }
-            ch = ch->sibling;
-        }
-        return false;
+        int ch = find(path, "file/folder");
+        if (!~ch) return false;
+        (*inodes)[ch].rwx = _rwx;
+        return true;
     }
 
-    bool cd(const char* name)
+    bool cd(const char* path)
     {
-        if (!strcmp(name, ".")) return true;
-        if (!strcmp(name, ".."))
+        if (!strcmp(path, ".")) return true;
+        if (!strcmp(path, ".."))
         {
-            if (now->parent) now = now->parent;
+            if (now != root_folder) now = (*inodes)[now].parent;
             return true;
         }
 
-        folder_control_block* dst_folder = nullptr;
-        if ((dst_folder = find_folder(name, now)) == nullptr)
+        int dst_folder = find_folder(path);
+        if (!~dst_folder)
             return false;
 
-        if (dst_folder->get_rwx() & X)
+        if ((*inodes)[dst_folder].rwx & X)
         {
             now = dst_folder;
-            printf("dir: %s\n", now->get_name());
+            printf("dir: %s\n", dst_folder == root_folder ? "/" : inodes->name(now));
             return true;
         }
         fprintf(stderr, "Permission denied.\n");
         return false;
     }
 
+    void defragment()
+    {
+        touch_image();
+        const Memory_simulator::Defragment_report& report = mem->defragment();
+        printf("defragment: %d segment(s), %d byte(s) moved, %.3f ms\n",
+               report.segments_moved, report.bytes_moved, report.time_ms);
+    }
+
+    long long defragments() {return mem->stats().defragments;}
+
+    void memstat()
+    {
+        Memory_simulator::Mem_stats st = mem->stats();
+        printf("arena: %d byte(s), free: %d, largest free: %d, fragmentation: %.3f\n",
+               st.capacity, st.free_bytes, st.largest_free, st.fragmentation);
+        printf("segments: %d (%d free), stale heap entries: ", st.segments, st.free_segments);
+        if (~st.stale_heap) printf("%d\n", st.stale_heap);
+        else printf("n/a\n");
+        printf("apply: %lld (%lld failed), avg %.1f ns; free: %lld, avg %.1f ns\n",
+               st.applies, st.apply_fails, st.applies ? st.apply_ns / st.applies : 0.0,
+               st.frees, st.frees ? st.free_ns / st.frees : 0.0);
+    }
+
     void show_all()
     {
         mem->show();
-        show_tree(&root_folder, 0);
+        const Pool_stats& seg = mem->node_stats();
+        printf("pool: segment nodes %lld/%lld (served without heap allocation)\n", seg.avoided(), seg.requests);
+        printf("inodes: %d, extents: %d, name bytes: %d, table bytes: %lld\n",
+               inodes->size(), inodes->extents(), inodes->name_bytes(), inodes->bytes());
+        const Dentry_cache<Inode_table>& dentries = inodes->dentry_cache();
+        printf("dentry cache: %lld hit(s), %lld miss(es), %d entries\n",
+               dentries.hits(), dentries.misses(), dentries.capacity());
+        show_tree(root_folder, 0);
     }
 };
 
-#endif /* _FILE_SIMULATOR_H_ */
\ No newline at end of file
+#endif /* _FILE_SIMULATOR_H_ */
@@ -0,0 +1,393 @@
+/*inode_table.h
+
+author: L1ttle-Q
+date: 2026-10-17
+
+flat inode table for the file namespace
+
+every file and folder is an Inode record in one contiguous array and is
+addressed by its index; the tree links (parent, first child, siblings) are
+indices as well, so a walk reads neighbouring records instead of chasing
+heap pointers. names live NUL-terminated in one shared string arena and
+file extents in a second array, chained by index.
+
+freed records and extents are recycled through free lists. the names of
+freed or renamed nodes become garbage; the arena is compacted once that
+is over half of it. folders with many children get a Name_index
+(see name_index.h), and lookup goes through a bounded Dentry_cache
+(see dentry_cache.h) first, so resolving a path costs about one hash
+probe per component.
+
+create and add_extent may grow the arrays: hold indices, not references,
+across them.
+*/
+
+#ifndef _INODE_TABLE_H_
+#define _INODE_TABLE_H_
+
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include "name_index.h"
+#include "dentry_cache.h"
+
+const int MAX_NAME_LENGTH = 64; // including the NUL; longer names are cut
+
+enum Node_kind
+{
+    kind_free, // a recycled record
+    kind_file,
+    kind_folder
+};
+
+struct Extent_record
+{
+    int first;
+    int id;   // segment handle from Memory_simulator::apply
+    int size;
+    int next; // next extent of the same file (or free record), -1 at the end
+};
+
+struct Inode
+{
+    struct Folder_part
+    {
+        int child;     // first child, -1 for none
+        int child_cnt;
+        int files;     // files in the subtree
+        int index;     // name index slot, -1 while the folder is small
+    };
+    struct File_part
+    {
+        int extent;    // first extent record, -1 for none
+        int last_extent;
+        int extent_cnt;
+    };
+
+    int parent;       // -1 for a root
+    int sibling;      // next child of parent (next free record once freed), -1 at the end
+    int prev_sibling; // -1 for the first child
+    int name;         // offset in the string arena
+    time_t ctime, mtime;
+    int size;         // file bytes; for a folder, bytes of every file below it
+    unsigned short rwx;
+    unsigned char kind;
+    union
+    {
+        Folder_part folder;
+        File_part file;
+    };
+
+    bool is_file() const {return kind == kind_file;}
+    bool is_folder() const {return kind == kind_folder;}
+};
+
+class Inode_table
+{
+public:
+    static const int INDEX_MIN = 32; // children before a folder gets a name index
+    static constexpr int DENTRY_CACHE_SIZE = 4096; // constexpr, so binding it to a reference needs no definition
+
+private:
+    static const int NAME_COMPACT_MIN = 4096; // garbage bytes tolerated regardless of ratio
+
+    std::vector<Inode> nodes;
+    int free_node;
+    int live_nodes;
+
+    std::vector<char> names;
+    int name_garbage;
+
+    std::vector<Extent_record> extent_pool;
+    int free_extent;
+    int live_extents;
+
+    std::vector< Name_index<Inode_table>* > indexes;
+    std::vector<int> free_indexes;
+
+    Dentry_cache<Inode_table> dentries;
+
+    int store_name(const char* name)
+    {
+        int len = strnlen(name, MAX_NAME_LENGTH - 1);
+        int at = names.size();
+        names.insert(names.end(), name, name + len);
+        names.push_back('\0');
+        return at;
+    }
+
+    void compact_names()
+    {
+        if (name_garbage < NAME_COMPACT_MIN || 2 * name_garbage < (int)names.size()) return;
+        std::vector<char> packed;
+        packed.reserve(names.size() - name_garbage);
+        for (Inode& node : nodes)
+        {
+            if (node.kind == kind_free) continue;
+            const char* s = &names[node.name];
+            node.name = packed.size();
+            packed.insert(packed.end(), s, s + strlen(s) + 1);
+        }
+        names.swap(packed);
+        name_garbage = 0;
+    }
+
+    void build_index(const int& folder)
+    {
+        int slot;
+        if (!free_indexes.empty())
+        {
+            slot = free_indexes.back();
+            free_indexes.pop_back();
+        }
+        else
+        {
+            slot = indexes.size();
+            indexes.push_back(nullptr);
+        }
+        indexes[slot] = new Name_index<Inode_table>(this);
+        for (int ch = nodes[folder].folder.child; ~ch; ch = nodes[ch].sibling) indexes[slot]->insert(ch);
+        nodes[folder].folder.index = slot;
+    }
+
+    void drop_index(const int& slot)
+    {
+        delete indexes[slot];
+        indexes[slot] = nullptr;
+        free_indexes.push_back(slot);
+    }
+
+    void free_extent_record(const int& e)
+    {
+        extent_pool[e].next = free_extent;
+        free_extent = e;
+        live_extents--;
+    }
+
+public:
+    Inode_table():
+        free_node(-1), live_nodes(0), name_garbage(0), free_extent(-1), live_extents(0),
+        dentries(this, DENTRY_CACHE_SIZE) {}
+    Inode_table(const Inode_table&) = delete;
+    Inode_table& operator = (const Inode_table&) = delete;
+    ~Inode_table()
+    {
+        for (Name_index<Inode_table>* index : indexes) delete index;
+    }
+
+    Inode& operator [] (const int& i) {return nodes[i];}
+    const Inode& operator [] (const int& i) const {return nodes[i];}
+    const char* name(const int& i) const {return &names[nodes[i].name];}
+
+    // a new, unlinked node
+    int create(const char* name, const Node_kind& kind, const time_t& t, const int& rwx)
+    {
+        int i;
+        if (~free_node)
+        {
+            i = free_node;
+            free_node = nodes[i].sibling;
+        }
+        else
+        {
+            i = nodes.size();
+            nodes.emplace_back();
+        }
+        int at = store_name(name);
+        Inode& node = nodes[i];
+        node.parent = node.sibling = node.prev_sibling = -1;
+        node.name = at;
+        node.ctime = node.mtime = t;
+        node.size = 0;
+        node.rwx = rwx;
+        node.kind = kind;
+        if (kind == kind_folder) node.folder = Inode::Folder_part{-1, 0, 0, -1};
+        else node.file = Inode::File_part{-1, -1, 0};
+        live_nodes++;
+        return i;
+    }
+
+    // free an unlinked node and everything below it; the segment handles of
+    // their extents are appended to ids for the caller to give back
+    void erase(const int& i, std::vector<int>& ids)
+    {
+        std::vector<int> stack(1, i);
+        while (!stack.empty())
+        {
+            int cur = stack.back();
+            stack.pop_back();
+            Inode& node = nodes[cur];
+            if (node.is_folder())
+            {
+                for (int ch = node.folder.child; ~ch; ch = nodes[ch].sibling) stack.push_back(ch);
+                if (~node.folder.index) drop_index(node.folder.index);
+            }
+            else
+                for (int e = node.file.extent, next; ~e; e = next)
+                {
+                    next = extent_pool[e].next;
+                    ids.push_back(extent_pool[e].id);
+                    free_extent_record(e);
+                }
+            name_garbage += strlen(&names[node.name]) + 1;
+            node.kind = kind_free;
+            node.sibling = free_node;
+            free_node = cur;
+            live_nodes--;
+        }
+        compact_names();
+    }
+
+    // fold a change below folder into it and every ancestor
+    void account(const int& folder, const int& size_delta, const int& file_delta)
+    {
+        for (int f = folder; ~f; f = nodes[f].parent)
+        {
+            nodes[f].size += size_delta;
+            nodes[f].folder.files += file_delta;
+        }
+    }
+
+    int files(const int& i) const {return nodes[i].is_folder() ? nodes[i].folder.files : 1;}
+
+    // -1 when folder has no child of that name
+    int find_child(const int& folder, const char* name) const
+    {
+        const Inode::Folder_part& f = nodes[folder].folder;
+        if (~f.index) return indexes[f.index]->find(name);
+        for (int ch = f.child; ~ch; ch = nodes[ch].sibling)
+            if (!strcmp(&names[nodes[ch].name], name)) return ch;
+        return -1;
+    }
+
+    // find_child through the dentry cache
+    int lookup(const int& folder, const char* name)
+    {
+        const unsigned int h = name_hash(name);
+        int ch = dentries.find(folder, name, h);
+        if (~ch) return ch;
+        ch = find_child(folder, name);
+        if (~ch) dentries.insert(folder, h, ch);
+        return ch;
+    }
+
+    bool is_child(const int& folder, const int& i, const char* name) const
+    {
+        return nodes[i].kind != kind_free && nodes[i].parent == folder && !strcmp(&names[nodes[i].name], name);
+    }
+
+    const Dentry_cache<Inode_table>& dentry_cache() const {return dentries;}
+
+    // link child after the child after, or first for -1; its name must be free
+    void add_child(const int& folder, const int& child, const int& after = -1)
+    {
+        Inode::Folder_part& f = nodes[folder].folder;
+        Inode& node = nodes[child];
+        int next = ~after ? nodes[after].sibling : f.child;
+        node.parent = folder;
+        node.prev_sibling = after;
+        node.sibling = next;
+        if (~next) nodes[next].prev_sibling = child;
+        if (~after) nodes[after].sibling = child;
+        else f.child = child;
+        f.child_cnt++;
+        if (~f.index) indexes[f.index]->insert(child);
+        else if (f.child_cnt >= INDEX_MIN) build_index(folder);
+        account(folder, node.size, files(child));
+    }
+
+    // unlink child from its folder; it stays allocated
+    void remove_child(const int& child)
+    {
+        Inode& node = nodes[child];
+        const int folder = node.parent;
+        Inode::Folder_part& f = nodes[folder].folder;
+        if (~f.index) indexes[f.index]->erase(child);
+        dentries.erase(folder, &names[node.name]);
+        if (~node.prev_sibling) nodes[node.prev_sibling].sibling = node.sibling;
+        else f.child = node.sibling;
+        if (~node.sibling) nodes[node.sibling].prev_sibling = node.prev_sibling;
+        node.parent = node.sibling = node.prev_sibling = -1;
+        f.child_cnt--;
+        account(folder, -node.size, -files(child));
+    }
+
+    void rename(const int& i, const char* name)
+    {
+        int parent = nodes[i].parent;
+        Name_index<Inode_table>* index = ~parent && ~nodes[parent].folder.index ? indexes[nodes[parent].folder.index] : nullptr;
+        if (index) index->erase(i);
+        if (~parent) dentries.erase(parent, &names[nodes[i].name]);
+        name_garbage += strlen(&names[nodes[i].name]) + 1;
+        int at = store_name(name);
+        nodes[i].name = at;
+        if (index) index->insert(i);
+        compact_names();
+    }
+
+    // append an extent to file; returns its record
+    int add_extent(const int& file, const int& first, const int& id, const int& size)
+    {
+        int e;
+        if (~free_extent)
+        {
+            e = free_extent;
+            free_extent = extent_pool[e].next;
+        }
+        else
+        {
+            e = extent_pool.size();
+            extent_pool.emplace_back();
+        }
+        extent_pool[e] = Extent_record{first, id, size, -1};
+        Inode::File_part& f = nodes[file].file;
+        if (~f.last_extent) extent_pool[f.last_extent].next = e;
+        else f.extent = e;
+        f.last_extent = e;
+        f.extent_cnt++;
+        live_extents++;
+        return e;
+    }
+
+    Extent_record& extent(const int& e) {return extent_pool[e];}
+    const Extent_record& extent(const int& e) const {return extent_pool[e];}
+
+    // keep the first keep extents of file; the handles of the rest go to ids
+    void truncate_extents(const int& file, const int& keep, std::vector<int>& ids)
+    {
+        Inode::File_part& f = nodes[file].file;
+        int last = -1, e = f.extent;
+        for (int k = 0; k < keep && ~e; k++)
+        {
+            last = e;
+            e = extent_pool[e].next;
+        }
+        for (int next; ~e; e = next)
+        {
+            next = extent_pool[e].next;
+            ids.push_back(extent_pool[e].id);
+            free_extent_record(e);
+            f.extent_cnt--;
+        }
+        if (~last) extent_pool[last].next = -1;
+        else f.extent = -1;
+        f.last_extent = last;
+    }
+
+    int size() const {return live_nodes;}
+    int extents() const {return live_extents;}
+    int name_bytes() const {return names.size() - name_garbage;}
+
+    // bytes held by the table, name indexes and the dentry cache included
+    long long bytes() const
+    {
+        long long res = nodes.capacity() * sizeof(Inode) + names.capacity() +
+                        extent_pool.capacity() * sizeof(Extent_record) + dentries.bytes();
+        for (const Name_index<Inode_table>* index : indexes)
+            if (index) res += index->bytes();
+        return res;
+    }
+};
+
+#endif /* _INODE_TABLE_H_ */
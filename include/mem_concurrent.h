@@ -0,0 +1,208 @@
+/*mem_concurrent.h
+
+author: L1ttle-Q
+date: 2026-10-17
+
+concurrent allocator mode
+
+Concurrent_simulator lets several threads apply and free on one arena.
+a Memory_simulator backend (any strategy) sits behind a mutex; requests up to
+SMALL_MAX bytes are rounded up to a SMALL_STEP size class and served from a
+per-thread cache of class-sized blocks, so a steady small churn never takes
+the lock. a cache is refilled CACHE_BATCH blocks at a time and, once a class
+holds more than CACHE_MAX blocks, half of it goes back in one free_batch.
+
+handles: a small block's handle is its offset, a large one's is the
+backend's. free takes the size that was applied, so both are told apart
+without a shared lookup (sized free). blocks freed on another thread join
+that thread's cache.
+
+the backend never compacts (set_auto_compact(false)): cached and live
+offsets stay fixed, and apply fails instead. bind storage before the
+threads start; arena growth is serialized by the lock, but a thread that
+keeps a raw pointer into the arena across a growth sees the old mapping.
+*/
+
+#ifndef _MEM_CONCURRENT_H_
+#define _MEM_CONCURRENT_H_
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mem_simulator.h"
+
+class Concurrent_simulator
+{
+public:
+    static const int SMALL_STEP = 16;
+    static const int SMALL_MAX = 256;
+    static const int SMALL_CLASS_CNT = SMALL_MAX / SMALL_STEP;
+    static const int CACHE_BATCH = 32;
+    static const int CACHE_MAX = 128;
+
+    struct Cache_stats
+    {
+        long long hits;    // small applies served without the lock
+        long long refills;
+        long long flushes;
+    };
+
+private:
+    struct Thread_cache
+    {
+        std::thread::id owner;
+        std::vector<int> blocks[SMALL_CLASS_CNT]; // offsets
+    };
+
+    // which cache the calling thread last used, for which instance
+    struct Cache_memo
+    {
+        unsigned int serial;
+        Thread_cache* cache;
+    };
+
+    Memory_simulator backend;
+    std::mutex lock;
+    std::vector<Thread_cache*> caches; // one per thread that ever applied or freed; under lock
+    unsigned int serial;               // never reused, unlike an address
+    std::atomic<long long> hits, refills, flushes;
+
+    static unsigned int next_serial()
+    {
+        static std::atomic<unsigned int> serial_cnt(0);
+        return ++serial_cnt;
+    }
+
+    static int size_class(const int& size) {return (size - 1) / SMALL_STEP;}
+
+    Thread_cache* local_cache()
+    {
+        static thread_local Cache_memo memo = {0, nullptr};
+        if (memo.serial == serial) return memo.cache;
+        std::lock_guard<std::mutex> guard(lock);
+        std::thread::id self = std::this_thread::get_id();
+        Thread_cache* cache = nullptr;
+        for (Thread_cache* c : caches)
+            if (c->owner == self) {cache = c; break;}
+        if (!cache)
+        {
+            cache = new Thread_cache();
+            cache->owner = self;
+            caches.push_back(cache);
+        }
+        memo.serial = serial;
+        memo.cache = cache;
+        return cache;
+    }
+
+    // give count blocks from the back of a class back to the backend, lock held
+    void release_blocks(std::vector<int>& blocks, const int& count)
+    {
+        std::vector<int> ids;
+        ids.reserve(count);
+        for (int i = 0; i < count; i++)
+        {
+            ids.push_back(backend.get_id(blocks.back()));
+            blocks.pop_back();
+        }
+        backend.free_batch(ids);
+    }
+
+public:
+    explicit Concurrent_simulator(const int& size = MEMORY_STORAGY, const Strategy& s = strategy):
+        backend(size, s), serial(next_serial()), hits(0), refills(0), flushes(0)
+    {
+        backend.set_auto_compact(false);
+    }
+    Concurrent_simulator(const Concurrent_simulator&) = delete;
+    Concurrent_simulator& operator = (const Concurrent_simulator&) = delete;
+    ~Concurrent_simulator()
+    {
+        for (Thread_cache* c : caches) delete c;
+    }
+
+    // before any thread applies; see Memory_simulator_base::bind_storage
+    void bind_storage(char** _storage, Memory_simulator::Relocate_callback _relocate, const int& limit = 0)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        backend.bind_storage(_storage, _relocate, limit);
+    }
+
+    // first byte of the block, -1 when nothing fits
+    int apply(const int& size, int& handle)
+    {
+        handle = -1;
+        if (size <= 0 || size > SMALL_MAX)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return backend.apply(size, handle);
+        }
+        const int c = size_class(size);
+        std::vector<int>& blocks = local_cache()->blocks[c];
+        if (blocks.empty())
+        {
+            const int class_size = (c + 1) * SMALL_STEP;
+            std::lock_guard<std::mutex> guard(lock);
+            for (int i = 0; i < CACHE_BATCH; i++)
+            {
+                int id, first = backend.apply(class_size, id);
+                if (first == -1) break;
+                blocks.push_back(first);
+            }
+            refills.fetch_add(1, std::memory_order_relaxed);
+            if (blocks.empty()) return -1;
+        }
+        else hits.fetch_add(1, std::memory_order_relaxed);
+        handle = blocks.back();
+        blocks.pop_back();
+        return handle;
+    }
+
+    // size is the one passed to apply
+    bool free(const int& handle, const int& size)
+    {
+        if (size <= 0 || size > SMALL_MAX)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return backend.free(handle);
+        }
+        std::vector<int>& blocks = local_cache()->blocks[size_class(size)];
+        blocks.push_back(handle);
+        if ((int)blocks.size() > CACHE_MAX)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            release_blocks(blocks, CACHE_MAX / 2);
+            flushes.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // hand the calling thread's cached blocks back, e.g. before it exits
+    void flush_thread_cache()
+    {
+        Thread_cache* cache = local_cache();
+        std::lock_guard<std::mutex> guard(lock);
+        for (int c = 0; c < SMALL_CLASS_CNT; c++)
+            if (!cache->blocks[c].empty()) release_blocks(cache->blocks[c], cache->blocks[c].size());
+    }
+
+    // cached blocks count as allocated
+    Memory_simulator::Mem_stats stats()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return backend.stats();
+    }
+
+    Cache_stats cache_stats() const
+    {
+        Cache_stats res;
+        res.hits = hits.load(std::memory_order_relaxed);
+        res.refills = refills.load(std::memory_order_relaxed);
+        res.flushes = flushes.load(std::memory_order_relaxed);
+        return res;
+    }
+};
+
+#endif /* _MEM_CONCURRENT_H_ */
@@ -0,0 +1,78 @@
+/*mem_engine.h
+
+author: L1ttle-Q
+date: 2026-10-17
+
+allocator engine interface
+
+strategies that do not run on the Memory_simulator segment list
+(tlsf, ...) implement this; Engine_simulator<Engine> holds one by value
+and calls it directly.
+handles are engine defined; an engine may use the segment offset.
+*/
+
+#ifndef _MEM_ENGINE_H_
+#define _MEM_ENGINE_H_
+
+inline int highest_bit(const unsigned int& x) // x != 0
+{
+#ifdef __GNUC__
+    return 31 - __builtin_clz(x);
+#else
+    int c = 0;
+    while ((x >> (c + 1)) > 0) c++;
+    return c;
+#endif
+}
+
+inline int lowest_bit(const unsigned int& x) // x != 0
+{
+#ifdef __GNUC__
+    return __builtin_ctz(x);
+#else
+    int c = 0;
+    while (!((x >> c) & 1)) c++;
+    return c;
+#endif
+}
+
+inline int lowest_bit64(const unsigned long long& x) // x != 0
+{
+#ifdef __GNUC__
+    return __builtin_ctzll(x);
+#else
+    int c = 0;
+    while (!((x >> c) & 1)) c++;
+    return c;
+#endif
+}
+
+inline int highest_bit64(const unsigned long long& x) // x != 0
+{
+#ifdef __GNUC__
+    return 63 - __builtin_clzll(x);
+#else
+    int c = 0;
+    while ((x >> (c + 1)) > 0) c++;
+    return c;
+#endif
+}
+
+class Memory_engine
+{
+public:
+    virtual ~Memory_engine() {}
+
+    virtual int apply(const int& size, int& id) = 0; // return segment first place; fail for -1
+    virtual bool free(const int& id) = 0;
+    virtual bool resize(const int&, const int&) {return false;} // in place only; false leaves it untouched
+    virtual int get_id(const int& locate) = 0;
+    virtual int free_space() const = 0;
+    virtual int largest_free() = 0; // a size apply is sure to place
+    virtual int segments() const = 0;      // blocks in the arena, allocated and free; kept as counters
+    virtual int free_segments() const = 0;
+    virtual bool grow(const int&) {return false;} // new bytes are appended free at the end
+    virtual void show() = 0;
+};
+
+#endif /* _MEM_ENGINE_H_ */
@@ -2,7 +2,7 @@
 
 author: L1ttle-Q
 date: 2025-5-10
-upd: 2025-6-8
+upd: 2026-10-17
 
 memory simulator
 strategy:
@@ -10,42 +10,89 @@ first fit
 best fit
 next fit
 worst fit
+segregated fit
+tlsf (engine, see tlsf_engine.h)
+buddy (engine, see buddy_engine.h)
+bitmap (engine, see bitmap_engine.h)
 
 operation:
 show
 alloc
-free
+free (single or batched)
+resize (in place)
 exit
 
 memory merge
 memory defragmentation
+arena growth (doubling, up to a limit)
+call tracing (see mem_trace.h)
+concurrent use (see mem_concurrent.h)
+
+placement:
+the policy is a template parameter (Basic_memory_simulator<First_fit_policy>,
+Engine_simulator<Tlsf_engine>, ...), so each strategy compiles into its own
+fast path; Memory_simulator picks one per instance at runtime, by default
+the global strategy.
+
+zones (set_zones, segment list only):
+requests above a size boundary take the smallest free segment that fits
+(the highest of equals), found in the (size, offset) index; the rest go
+through the policy. a large request takes the tail of its hole; a small
+one the head, or the tail when the block above is small and the one below
+is large. small and large blocks then gather apart and a freed block tends
+to merge with free space of its own class. this helps the policies that pack (first,
+best, segregated fit); next and worst fit spread small requests by design
+and lose from it (see bench/mem_replay).
 
 structure:
-linked list
-priority queue
+linked list (nodes from a free-list pool)
+priority queue (lazy deletion, rebuilt once mostly stale)
+ordered index (offset -> segment)
+ordered index ((size, offset) -> free segment)
+size-class bins (power of two, bitmap of non-empty bins)
 */
 
 #ifndef _MEM_SIMULATOR_H_
 #define _MEM_SIMULATOR_H_
 
+#include <map>
+#include <set>
+#include <chrono>
 #include <queue>
 #include <cstdio>
 #include <vector>
 #include <cstring>
+
+#include "arena.h"
+#include "mem_engine.h"
+#include "node_pool.h"
+#include "mem_trace.h"
+#include "tlsf_engine.h"
+#include "buddy_engine.h"
+#include "bitmap_engine.h"
+using std::map;
+using std::set;
+using std::pair;
 using std::priority_queue;
 using std::less;
 using std::greater;
 using std::vector;
 
-const int SEGMENT_MAX = 1024;
-const int MEMORY_STORAGY = 32768;
+const int HEAP_STALE_SLACK = 64; // stale entries tolerated before the ratio check applies
+const int BIN_CNT = 32;          // size class c holds free segments of size [2^c, 2^(c+1))
+const int BIN_SCAN_MAX = 8;      // entries tried in the request's own class before moving up
+const int MEMORY_STORAGY = 32768; // default arena size
 
 enum Strategy
 {
     first_fit,
     best_fit,
     next_fit,
-    worst_fit
+    worst_fit,
+    segregated_fit,
+    tlsf,
+    buddy,
+    bitmap
 };
 extern Strategy strategy;
 extern bool Mem_op_print;
@@ -61,7 +108,178 @@ namespace mem_simulator_operation
     };
 }
 
-class Memory_simulator
+// state and interface every simulator shares; Memory_simulator holds one of these
+class Memory_simulator_base
+{
+public:
+    typedef void (*Relocate_callback)(void* owner, const int& id, const int& first);
+
+    struct Defragment_report
+    {
+        int segments_moved;
+        int bytes_moved;
+        double time_ms;
+
+        Defragment_report(): segments_moved(0), bytes_moved(0), time_ms(0) {}
+    };
+
+    struct Mem_stats
+    {
+        int capacity;
+        int free_bytes;
+        int largest_free;
+        double fragmentation; // external: 1 - largest_free / free_bytes, 0 when nothing is free
+        int segments;         // allocated and free
+        int free_segments;
+        int stale_heap;       // lazily deleted Max_heap entries not yet popped, -1 without a heap (engines)
+        long long applies;
+        long long apply_fails;
+        long long frees;
+        long long defragments; // explicit or run by apply
+        double apply_ns;      // cumulative, failures included
+        double free_ns;
+
+        Mem_stats(): capacity(0), free_bytes(0), largest_free(0), fragmentation(0), segments(0), free_segments(0),
+                     stale_heap(0), applies(0), apply_fails(0), frees(0), defragments(0), apply_ns(0), free_ns(0) {}
+    };
+
+protected:
+    int storage_size;
+    int storage_limit; // growth stops here; no growth unless storage is bound
+    char** storage;    // the caller's arena base, rewritten when growth moves it
+    Relocate_callback relocate;
+    Trace_recorder* trace; // every apply/free/resize is recorded when set
+    Mem_stats counters;    // call counts and latencies; the rest is read off the indexes
+    Defragment_report last_report;
+    bool auto_compact; // apply defragments when only fragmentation stands in the way
+
+    explicit Memory_simulator_base(const int& size):
+        storage_size(size), storage_limit(size), storage(nullptr), relocate(nullptr), trace(nullptr),
+        counters(), last_report(), auto_compact(true) {}
+
+    typedef std::chrono::steady_clock::time_point Time_point;
+    static Time_point now_time() {return std::chrono::steady_clock::now();}
+
+    void note_apply(const int& size, const int& first, const int& id, const Time_point& t0)
+    {
+        counters.apply_ns += std::chrono::duration<double, std::nano>(now_time() - t0).count();
+        counters.applies++;
+        if (first == -1) counters.apply_fails++;
+        if (trace) trace->record(trace_apply, size, first == -1 ? -1 : id);
+    }
+
+    void note_free(const int& freed, const Time_point& t0)
+    {
+        counters.free_ns += std::chrono::duration<double, std::nano>(now_time() - t0).count();
+        counters.frees += freed;
+    }
+
+    // remap the bound arena to new_size; the caller updates storage_size
+    // once its own bookkeeping has grown too
+    bool grow_storage(const int& new_size)
+    {
+        if (new_size > storage_limit) return false;
+        if (storage)
+        {
+            char* p = arena_grow(*storage, storage_size, new_size);
+            if (!p) return false;
+            *storage = p;
+        }
+        return true;
+    }
+
+    Mem_stats fill_stats(const int& free_segments, const int& stale_heap)
+    {
+        Mem_stats res = counters;
+        res.capacity = storage_size;
+        res.free_bytes = free_space();
+        res.largest_free = largest_free();
+        res.fragmentation = res.free_bytes ? 1.0 - (double)res.largest_free / res.free_bytes : 0;
+        res.segments = segments();
+        res.free_segments = free_segments;
+        res.stale_heap = stale_heap;
+        return res;
+    }
+
+public:
+    virtual ~Memory_simulator_base() {}
+
+    // id is the segment handle: it stays valid until the segment is freed,
+    // and free(id) reaches the segment without any search
+    virtual int apply(const int& size, int& id) = 0; // return applied segment first place; fail for -1
+    virtual bool free(const int& id) = 0;
+    // free every id; false if one of them was not allocated, the others are freed anyway
+    virtual bool free_batch(const vector<int>& ids)
+    {
+        bool ok = true;
+        for (const int& id : ids) ok = free(id) && ok;
+        return ok;
+    }
+    // grow into the free space right after id, or give back the tail;
+    // the segment keeps its place and id. false: nothing changed, relocate instead
+    virtual bool resize(const int& id, const int& size) = 0;
+    virtual int get_id(const int& locate) = 0;
+    virtual void show() = 0;
+    virtual int free_space() const = 0;
+    virtual int largest_free() = 0; // a size apply is sure to place without compacting
+    virtual int segments() = 0;
+    virtual bool grow(const int& new_size) = 0; // append new_size - capacity() free bytes at the end
+    // slide every allocated segment towards offset 0 (ids are kept), leaving
+    // a single free segment at the end; engines do not compact
+    virtual const Defragment_report& defragment() = 0;
+    virtual void set_owner(const int&, void*) {}
+    // requests above boundary bytes are kept apart from the smaller ones; 0 turns zones off
+    virtual void set_zones(const int&) {}
+    virtual bool restore(const vector< pair<int, int> >&, vector<int>&) {return false;}
+    virtual Mem_stats stats() = 0;
+    virtual const Pool_stats& node_stats() const = 0;
+
+    int apply(const int& size)
+    {
+        int id;
+        return apply(size, id);
+    }
+
+    bool free_by_locate(const int& locate) // compatibility path, prefer free(id)
+    {
+        int id = get_id(locate);
+        if (id == -1) return false;
+        return free(id);
+    }
+
+    // *_storage is the byte arena (from arena_alloc) the offsets refer to;
+    // defragment moves data inside it and reports every moved segment's new
+    // place to relocate. growth up to limit remaps it and updates *_storage
+    void bind_storage(char** _storage, Relocate_callback _relocate, const int& limit = 0)
+    {
+        storage = _storage;
+        relocate = _relocate;
+        storage_limit = limit > storage_size ? limit : storage_size;
+    }
+
+    int capacity() const {return storage_size;}
+    void set_trace(Trace_recorder* _trace) {trace = _trace;}
+    // off keeps every handed-out offset fixed; apply then fails instead of compacting
+    void set_auto_compact(const bool& on) {auto_compact = on;}
+    const Defragment_report& last_defragment() const {return last_report;}
+
+    // double the arena until a size segment can be placed, within the limit
+    bool expand_for(const int& size)
+    {
+        while (largest_free() < size)
+        {
+            if (storage_size >= storage_limit) return false;
+            long long target = (long long)storage_size * 2;
+            if (!grow(target < storage_limit ? (int)target : storage_limit)) return false;
+        }
+        return true;
+    }
+};
+
+// the segment list; Placement::decide(list, size) returns the first of a free
+// segment of at least size bytes (one is known to exist), or -1
+template <class Placement>
+class Basic_memory_simulator final : public Memory_simulator_base
 {
 private:
     struct Segment
@@ -70,7 +288,7 @@ private:
         int pid;
         int first;
         int end;
-        int status; // 0 for free; 1 for allocated
+        int status; // 0 for free; 1 for allocated; 2 and 3 only inside free_batch
         int last_modify;
 
         Segment(): id(0), pid(0), first(0), end(0), status(0), last_modify(0) {}
@@ -87,234 +305,416 @@ private:
         Segment content;
         Segment_List* prev;
         Segment_List* next;
+        void* owner; // passed back to the relocation callback when defragment moves it
+        Segment_List* bin_prev; // size-class bin links, free segments only
+        Segment_List* bin_next;
 
-        Segment_List(): content(), prev(nullptr), next(nullptr){}
+        Segment_List(): content(), prev(nullptr), next(nullptr), owner(nullptr),
+                        bin_prev(nullptr), bin_next(nullptr){}
     } segment_head;
 
+    Node_pool<Segment_List> node_pool;
+
+    friend Placement;
+
     priority_queue < Segment, vector<Segment>, less<Segment> > Max_heap;
-    priority_queue < Segment, vector<Segment>, greater<Segment> > Min_heap;
+    set< pair<int, int> > free_index; // (size, first) of every free segment, erased eagerly
+    Segment_List* bins[BIN_CNT];
+    unsigned int bin_map;             // bit c set iff bins[c] is non-empty
 
-    int next_locate;
-    int segment_cnt;
-    int Modify[SEGMENT_MAX];
+    map<int, Segment_List*> segment_index; // segment first -> node, kept alongside the list
+    vector<Segment_List*> id_node;         // segment id -> node, nullptr while the id is retired
 
-    Segment_List* locate_segment(const int& locate, const Segment_List& begin)
+    Segment_List* rover; // next_fit resumes here (nullptr: list head); moved onto the survivor of a merge
+    int zone_boundary;   // 0: no zones; otherwise larger requests are placed apart
+    int segment_cnt; // id slots, live or retired
+    int free_size;
+    vector<int> Modify;
+    vector<int> free_ids; // retired ids, handed out again before new slots
+
+    // a reused id keeps its Modify stamp, which only grows, so heap entries
+    // left from its previous segment stay stale
+    int new_id()
     {
-        if (locate < 0 || locate >= SEGMENT_MAX) return NULL;
-        Segment_List* now = begin.next;
-        while (now)
+        if (!free_ids.empty())
         {
-            if (now->content.end < locate)
-            {
-                now = now->next;
-                continue;
-            }
-            return now;
+            int id = free_ids.back();
+            free_ids.pop_back();
+            return id;
         }
-        return NULL;
+        Modify.push_back(0);
+        id_node.push_back(nullptr);
+        return segment_cnt++;
+    }
+
+    void retire_id(const int& id)
+    {
+        id_node[id] = nullptr;
+        if (id) free_ids.push_back(id); // 0 is never a valid handle: the first segment's id is not handed out again
+    }
+
+    Segment_List* locate_segment(const int& locate)
+    {
+        if (locate < 0 || locate >= storage_size) return NULL;
+        auto it = segment_index.upper_bound(locate);
+        if (it == segment_index.begin()) return NULL;
+        --it;
+        return it->second;
+    }
+
+    static int size_class(const int& size)
+    {
+        return highest_bit((unsigned int)size);
+    }
+
+    void push_free(Segment_List* node)
+    {
+        const Segment& seg = node->content;
+        free_index.insert(pair<int, int>(seg.size(), seg.first));
+        Max_heap.push(seg);
+        if (Max_heap.size() > 2 * free_index.size() + HEAP_STALE_SLACK)
+            rebuild_heap();
+
+        int c = size_class(seg.size());
+        node->bin_prev = nullptr;
+        node->bin_next = bins[c];
+        if (bins[c]) bins[c]->bin_prev = node;
+        bins[c] = node;
+        bin_map |= 1u << c;
+    }
+
+    void drop_free(Segment_List* node) // node is about to be merged, split or deleted
+    {
+        const Segment& seg = node->content;
+        free_index.erase(pair<int, int>(seg.size(), seg.first));
+        Modify[seg.id]++;
+
+        int c = size_class(seg.size());
+        if (node->bin_prev) node->bin_prev->bin_next = node->bin_next;
+        else bins[c] = node->bin_next;
+        if (node->bin_next) node->bin_next->bin_prev = node->bin_prev;
+        node->bin_prev = node->bin_next = nullptr;
+        if (!bins[c]) bin_map &= ~(1u << c);
+    }
+
+    // more than half of Max_heap is stale: rebuild it from the live free segments in O(n)
+    void rebuild_heap()
+    {
+        vector<Segment> live;
+        live.reserve(free_index.size());
+        for (const auto& item : free_index)
+            live.push_back(segment_index[item.second]->content);
+        Max_heap = decltype(Max_heap)(less<Segment>(), std::move(live));
+    }
+
+    const Segment* max_free()
+    {
+        while (!Max_heap.empty() && Max_heap.top().last_modify < Modify[Max_heap.top().id])
+            Max_heap.pop();
+        if (Max_heap.empty()) return NULL;
+        return &Max_heap.top();
     }
 
     bool could_allocate(const int& size)
     {
-        Segment now;
-        while (!Max_heap.empty())
-        {
-            now = Max_heap.top(); Max_heap.pop();
-            if (now.last_modify < Modify[now.id]) continue;
-            Max_heap.push(now);
-            if (now.size() < size)
-                return false;
-            return true;
-        }
-        return false;
+        const Segment* now = max_free();
+        return now && now->size() >= size;
     }
 
     int decide_memory(const int& size)
     {
-        static vector<Segment> temp_segments;
-
         if (size <= 0 || !could_allocate(size)) return -1;
+        if (zone_boundary && size > zone_boundary) return zone_place(decide_large(size), size);
 
-        Segment_List* pnow;
-        Segment now;
-        switch (strategy)
-        {
-            case first_fit:
-            pnow = segment_head.next;
-            while (pnow)
-            {
-                if (pnow->content.status || pnow->content.size() < size)
-                {
-                    pnow = pnow->next;
-                    continue;
-                }
-                return pnow->content.first;
-            }
-            break;
+        int first = Placement::decide(*this, size);
+        return zone_boundary && ~first ? zone_place(locate_segment(first), size) : first;
+    }
 
-            case best_fit:
-            while (!Min_heap.empty())
-            {
-                now = Min_heap.top(); Min_heap.pop();
-                if (now.last_modify < Modify[now.id]) continue;
-                temp_segments.push_back(now);
-                if (now.size() >= size)
-                {
-                    for (const auto& seg : temp_segments)
-                        Min_heap.push(seg);
-                    temp_segments.clear();
-                    return now.first;
-                }
-            }
-            for (const auto& seg : temp_segments)
-                Min_heap.push(seg);
-            temp_segments.clear();
-            break;
-
-            case next_fit:
-            pnow = locate_segment(next_locate, segment_head);
-            while (pnow)
-            {
-                if (pnow->content.status || pnow->content.size() < size)
-                {
-                    pnow = pnow->next;
-                    if (!pnow) pnow = segment_head.next;
-                    continue;
-                }
-                return pnow->content.first;
-            }
-            break;
+    // large zone: the smallest free segment that fits, the highest of equals; could_allocate made sure one does
+    Segment_List* decide_large(const int& size)
+    {
+        auto it = free_index.lower_bound(pair<int, int>(size, -1));
+        it = --free_index.upper_bound(pair<int, int>(it->first, storage_size));
+        return segment_index[it->second];
+    }
 
-            case worst_fit:
-            while (!Max_heap.empty())
-            {
-                now = Max_heap.top(); Max_heap.pop();
-                if (now.last_modify < Modify[now.id]) continue;
-                Max_heap.push(now);
-                if (now.size() < size)
-                    return -1;
-                return now.first;
-            }
-            break;
-        }
-        return -1;
+    // large: the tail of the hole; small: the head, unless only the block above it is small
+    int zone_place(const Segment_List* hole, const int& size)
+    {
+        const Segment& seg = hole->content;
+        if (size > zone_boundary) return seg.end - size + 1;
+        bool below_large = hole->prev != &segment_head && hole->prev->content.size() > zone_boundary;
+        bool above_small = hole->next && hole->next->content.size() <= zone_boundary;
+        return below_large && above_small ? seg.end - size + 1 : seg.first;
     }
 
 public:
-    Memory_simulator(): segment_cnt(0), next_locate(0), segment_head()
+    using Memory_simulator_base::apply;
+
+    explicit Basic_memory_simulator(const int& size = MEMORY_STORAGY):
+        Memory_simulator_base(size), segment_head(), bin_map(0), rover(nullptr), zone_boundary(0), segment_cnt(0), free_size(size)
     {
-        Segment_List* new_node = new Segment_List();
+        for (int c = 0; c < BIN_CNT; c++) bins[c] = nullptr;
+        Segment_List* new_node = node_pool.create();
         segment_head.next = new_node;
         new_node->prev = &segment_head;
-        new_node->content = Segment(segment_cnt++, 0, 0, MEMORY_STORAGY - 1, 0, ++Modify[0]);
-        Max_heap.push(new_node->content);
-        Min_heap.push(new_node->content);
-        memset(Modify, 0, sizeof(Modify));
+        int id = new_id();
+        new_node->content = Segment(id, 0, 0, storage_size - 1, 0, ++Modify[id]);
+        segment_index[0] = new_node;
+        id_node[id] = new_node;
+        push_free(new_node);
     }
 
-    int apply(const int& size) // return applied segment first place; fail for -1
+    int apply(const int& size, int& id)
     {
+        Time_point t0 = now_time();
+        int first = place(size, id);
+        note_apply(size, first, id, t0);
+        return first;
+    }
+
+private:
+    int place(const int& size, int& id)
+    {
+        id = -1;
         int decide = decide_memory(size);
+        if (!~decide && auto_compact && size > 0 && size <= free_size)
+        {
+            defragment(); // enough bytes in total, only fragmented
+            decide = decide_memory(size);
+        }
+        if (!~decide && size > 0 && expand_for(size))
+            decide = decide_memory(size);
         if (!~decide)
         {
             fprintf(stderr, "error: cannot alloc.\n");
             return -1;
         }
 
-        Segment_List* new_seg = new Segment_List();
+        Segment_List* new_seg = node_pool.create();
         Segment& now = new_seg->content;
-        now.id = segment_cnt++;
+        now.id = new_id();
         now.first = decide;
         now.end = decide + size - 1;
         now.status = 1;
         now.last_modify = ++Modify[now.id];
+        id_node[now.id] = new_seg;
+        free_size -= size;
 
-        next_locate = (now.end + 1) % SEGMENT_MAX;
-
-        Segment_List* last_seg = locate_segment(decide, segment_head);
-        Modify[last_seg->content.id]++;
-        last_seg->prev->next = new_seg;
-        new_seg->prev = last_seg->prev;
+        // the hole becomes [free head] new [free tail]; a head keeps the hole's node and id
+        Segment_List* last_seg = locate_segment(decide);
+        const Segment hole = last_seg->content;
+        Segment_List* after = last_seg->next;
+        drop_free(last_seg);
+        segment_index[decide] = new_seg;
+        bool keep_head = decide > hole.first; // only a zoned placement leaves one
+        if (keep_head)
+        {
+            last_seg->content.end = decide - 1;
+            last_seg->content.last_modify = ++Modify[hole.id];
+            push_free(last_seg);
+            last_seg->next = new_seg;
+            new_seg->prev = last_seg;
+        }
+        else
+        {
+            if (hole.end == now.end) retire_id(hole.id); // otherwise the free tail takes the id over
+            last_seg->prev->next = new_seg;
+            new_seg->prev = last_seg->prev;
+        }
 
-        Segment_List* next_seg = last_seg->next;
-        if (last_seg->content.size() > size)
+        Segment_List* next_seg = after;
+        if (hole.end > now.end)
         {
-            next_seg = new Segment_List();
-            next_seg->content = Segment(last_seg->content.id, 0, new_seg->content.end + 1, last_seg->content.end, 0, ++Modify[last_seg->content.id]);
-            next_seg->next = last_seg->next;
-            if (last_seg->next) last_seg->next->prev = next_seg;
-            Max_heap.push(next_seg->content);
-            Min_heap.push(next_seg->content);
+            int tail_id = keep_head ? new_id() : hole.id;
+            next_seg = node_pool.create();
+            next_seg->content = Segment(tail_id, 0, now.end + 1, hole.end, 0, ++Modify[tail_id]);
+            next_seg->next = after;
+            if (after) after->prev = next_seg;
+            segment_index[next_seg->content.first] = next_seg;
+            id_node[tail_id] = next_seg;
+            push_free(next_seg);
         }
         new_seg->next = next_seg;
         if (next_seg) next_seg->prev = new_seg;
-        delete last_seg;
+        if (!keep_head)
+        {
+            if (rover == last_seg) rover = new_seg->next;
+            node_pool.destroy(last_seg);
+        }
+        if (!zone_boundary || size <= zone_boundary) rover = new_seg->next;
 
         if (Mem_op_print)
             printf("alloc: id: %d, range[%d, %d]\n", now.id, now.first, now.end);
 
+        id = now.id;
         return decide;
     }
 
-    bool free_by_locate(const int& locate)
+public:
+    int get_id(const int& locate)
     {
-        int id = get_id(locate);
-        if (id == -1) return false;
-        return free(id);
+        if (locate < 0 || locate >= storage_size)
+            return -1;
+
+        Segment_List* now = locate_segment(locate);
+        if (!now || now->content.end < locate)
+        {
+            fprintf(stderr, "error: wrong location.\n");
+            return -1;
+        }
+        return now->content.id;
     }
 
-    int get_id(const int& locate)
+    bool resize(const int& id, const int& size)
     {
-        if (locate < 0 || locate >= MEMORY_STORAGY)
-            return -1;
+        if (trace) trace->record(trace_resize, size, id);
+        if (id <= 0 || segment_cnt <= id || size <= 0) return false;
+        Segment_List* now = id_node[id];
+        if (!now || !now->content.status) return false;
 
-        Segment_List* now = segment_head.next;
-        Segment* dst_seg = NULL;
+        Segment& seg = now->content;
+        int delta = size - seg.size();
+        if (!delta) return true;
 
-        while (now)
+        Segment_List* next = now->next;
+        bool next_free = next && !next->content.status;
+        if (delta > 0 && (!next_free || next->content.size() < delta)) return false;
+
+        if (next_free)
         {
-            if (now->content.first <= locate && now->content.end >= locate)
-            {
-                dst_seg = &(now->content);
-                break;
-            }
-            now = now->next;
+            drop_free(next);
+            segment_index.erase(next->content.first);
         }
-        if (!dst_seg)
+        seg.end += delta;
+        if (next_free && next->content.end == seg.end) // absorbed completely
         {
-            fprintf(stderr, "error: wrong location.\n");
-            return -1;
+            retire_id(next->content.id);
+            now->next = next->next;
+            if (next->next) next->next->prev = now;
+            if (rover == next) rover = now;
+            node_pool.destroy(next);
         }
-        return dst_seg->id;
+        else if (next_free) // neighbour moves by delta
+        {
+            next->content.first = seg.end + 1;
+            next->content.last_modify = ++Modify[next->content.id];
+            segment_index[next->content.first] = next;
+            push_free(next);
+        }
+        else // shrink next to an allocated segment (or the end): new free tail
+        {
+            Segment_List* tail = node_pool.create();
+            int tail_id = new_id();
+            tail->content = Segment(tail_id, 0, seg.end + 1, seg.end - delta, 0, ++Modify[tail_id]);
+            tail->prev = now;
+            tail->next = next;
+            if (next) next->prev = tail;
+            now->next = tail;
+            segment_index[tail->content.first] = tail;
+            id_node[tail_id] = tail;
+            push_free(tail);
+        }
+        free_size -= delta;
+
+        if (Mem_op_print)
+            printf("resize: id: %d, range[%d, %d]\n", seg.id, seg.first, seg.end);
+        return true;
     }
 
     bool free(const int& id)
     {
-        if (id <= 0 || segment_cnt <= id)
+        if (trace) trace->record(trace_free, 0, id);
+        Time_point t0 = now_time();
+        bool res = release(id);
+        note_free(res, t0);
+        return res;
+    }
+
+    // every segment is marked first; then each run of free neighbours around
+    // the marked ones is merged in one pass and enters the free indexes once
+    bool free_batch(const vector<int>& ids)
+    {
+        Time_point t0 = now_time();
+        bool ok = true;
+        vector<Segment_List*> marked;
+        marked.reserve(ids.size());
+        for (const int& id : ids)
         {
-            fprintf(stderr, "error: wrong id number.\n");
-            return false;
+            if (trace) trace->record(trace_free, 0, id);
+            Segment_List* node = id > 0 && id < segment_cnt ? id_node[id] : nullptr;
+            if (!node || node->content.status != 1)
+            {
+                fprintf(stderr, "error: cannot free.\n");
+                ok = false;
+                continue;
+            }
+            node->content.status = 2; // freed in this batch, not merged yet; its id retires with the merge
+            node->owner = nullptr;
+            free_size += node->content.size();
+            marked.push_back(node);
         }
-        Segment_List* now = segment_head.next;
-        Segment* dst_seg = NULL;
-        while (now)
+
+        // merged-away nodes are unlinked and marked 3, but only given back to
+        // the pool once no marked node is left to look at
+        vector<Segment_List*> merged;
+        for (Segment_List* node : marked)
         {
-            if (now->content.id == id)
+            if (node->content.status != 2) continue; // merged into an earlier run
+            Segment_List* keep = node;
+            while (keep->prev != &segment_head && keep->prev->content.status != 1) keep = keep->prev;
+            Segment& seg = keep->content;
+            if (!seg.status) drop_free(keep);
+            retire_id(seg.id);
+            seg.id = new_id();
+            seg.status = 0;
+            id_node[seg.id] = keep;
+            while (keep->next && keep->next->content.status != 1)
             {
-                dst_seg = &(now->content);
-                break;
+                Segment_List* tmp = keep->next;
+                if (!tmp->content.status) drop_free(tmp);
+                retire_id(tmp->content.id);
+                segment_index.erase(tmp->content.first);
+                seg.end = tmp->content.end;
+                keep->next = tmp->next;
+                if (tmp->next) tmp->next->prev = keep;
+                if (rover == tmp) rover = keep;
+                tmp->content.status = 3;
+                merged.push_back(tmp);
             }
-            now = now->next;
+            seg.last_modify = ++Modify[seg.id];
+            push_free(keep);
+            if (Mem_op_print)
+                printf("free: id: %d, range[%d, %d] size: %d\n", seg.id, seg.first, seg.end, seg.size());
+        }
+        for (Segment_List* node : merged) node_pool.destroy(node);
+        note_free(marked.size(), t0);
+        return ok;
+    }
+
+private:
+    bool release(const int& id)
+    {
+        if (id <= 0 || segment_cnt <= id)
+        {
+            fprintf(stderr, "error: wrong id number.\n");
+            return false;
         }
-        if (!dst_seg || !dst_seg->status)
+        Segment_List* now = id_node[id];
+        if (!now || !now->content.status)
         {
             fprintf(stderr, "error: cannot free.\n");
             return false;
         }
+        Segment* dst_seg = &(now->content);
+        free_size += dst_seg->size();
+        now->owner = nullptr;
 
-        dst_seg->id = segment_cnt++;
+        retire_id(id);
+        dst_seg->id = new_id();
         dst_seg->status = 0;
         dst_seg->last_modify = ++Modify[dst_seg->id];
+        id_node[dst_seg->id] = now;
 
         if (Mem_op_print)
             printf("free: id: %d, range[%d, %d] size: %d\n",
@@ -329,11 +729,15 @@ public:
                 if (Mem_op_print)
                     printf("merge: %d[%d, %d] %d[%d, %d]\n",
                         tmp->content.id, tmp->content.first, tmp->content.end, now->content.id, now->content.first, now->content.end);
+                segment_index.erase(dst_seg->first);
+                segment_index[tmp->content.first] = now;
                 dst_seg->first = tmp->content.first;
-                Modify[tmp->content.id]++;
+                drop_free(tmp);
+                retire_id(tmp->content.id);
                 tmp->prev->next = now;
                 now->prev = tmp->prev;
-                delete tmp;
+                if (rover == tmp) rover = now;
+                node_pool.destroy(tmp);
             }
         }
         if (now->next)
@@ -344,19 +748,22 @@ public:
                 if (Mem_op_print)
                     printf("merge: %d[%d, %d] %d[%d, %d]\n",
                         now->content.id, now->content.first, now->content.end, tmp->content.id, tmp->content.first, tmp->content.end);
+                segment_index.erase(tmp->content.first);
                 dst_seg->end = tmp->content.end;
-                Modify[tmp->content.id]++;
+                drop_free(tmp);
+                retire_id(tmp->content.id);
                 if (tmp->next) tmp->next->prev = now;
                 now->next = tmp->next;
-                delete tmp;
+                if (rover == tmp) rover = now;
+                node_pool.destroy(tmp);
             }
         }
 
-        Max_heap.push(*dst_seg);
-        Min_heap.push(*dst_seg);
+        push_free(now);
         return true;
     }
 
+public:
     void show()
     {
         printf("Memory Assignment:\n");
@@ -369,8 +776,378 @@ public:
         }
     }
 
-    void defragment()
-    {}
+    bool grow(const int& new_size)
+    {
+        if (new_size <= storage_size) return true;
+        if (!grow_storage(new_size)) return false;
+        int delta = new_size - storage_size;
+        storage_size = new_size;
+        if (Mem_op_print)
+            printf("grow: arena [0, %d]\n", storage_size - 1);
+
+        Segment_List* last = segment_index.rbegin()->second;
+        if (!last->content.status)
+        {
+            drop_free(last);
+            last->content.end += delta;
+            last->content.last_modify = ++Modify[last->content.id];
+            push_free(last);
+        }
+        else
+        {
+            Segment_List* tail = node_pool.create();
+            int id = new_id();
+            tail->content = Segment(id, 0, last->content.end + 1, storage_size - 1, 0, ++Modify[id]);
+            tail->prev = last;
+            last->next = tail;
+            segment_index[tail->content.first] = tail;
+            id_node[id] = tail;
+            push_free(tail);
+        }
+        free_size += delta;
+        return true;
+    }
+
+    void set_owner(const int& id, void* owner)
+    {
+        if (id <= 0 || segment_cnt <= id || !id_node[id]) return;
+        id_node[id]->owner = owner;
+    }
+
+    void set_zones(const int& boundary) {zone_boundary = boundary > 0 ? boundary : 0;}
+
+    // lay out a saved image on a fresh simulator: allocated holds the (first, size)
+    // of every live segment in address order, ids receives their new handles.
+    // false (nothing changed) for a used simulator or a bad layout
+    bool restore(const vector< pair<int, int> >& allocated, vector<int>& ids)
+    {
+        if (segment_index.size() != 1 || free_size != storage_size) return false;
+        int cursor = 0;
+        for (const auto& item : allocated)
+        {
+            if (item.first < cursor || item.second <= 0 || item.second > storage_size - item.first)
+                return false;
+            cursor = item.first + item.second;
+        }
+
+        Segment_List* init = segment_head.next;
+        drop_free(init);
+        retire_id(init->content.id);
+        segment_index.clear();
+        node_pool.destroy(init);
+        Max_heap = decltype(Max_heap)();
+
+        ids.clear();
+        Segment_List* last = &segment_head;
+        cursor = 0;
+        auto link = [&](const int& first, const int& end, const int& status)
+        {
+            Segment_List* node = node_pool.create();
+            int id = new_id();
+            node->content = Segment(id, 0, first, end, status, ++Modify[id]);
+            node->prev = last;
+            last->next = node;
+            segment_index[first] = node;
+            id_node[id] = node;
+            if (!status) push_free(node);
+            last = node;
+            return id;
+        };
+        for (const auto& item : allocated)
+        {
+            if (item.first > cursor) link(cursor, item.first - 1, 0);
+            ids.push_back(link(item.first, item.first + item.second - 1, 1));
+            free_size -= item.second;
+            cursor = item.first + item.second;
+        }
+        if (cursor < storage_size) link(cursor, storage_size - 1, 0);
+        last->next = nullptr;
+        rover = nullptr;
+        return true;
+    }
+
+    int free_space() const {return free_size;}
+    int segments() {return segment_index.size();}
+    int largest_free()
+    {
+        const Segment* seg = max_free();
+        return seg ? seg->size() : 0;
+    }
+    const Pool_stats& node_stats() const {return node_pool.stats();}
+
+    // O(1): the largest free block pops stale heap entries, amortized
+    Mem_stats stats()
+    {
+        max_free(); // pop the stale tops first, so the count below is current
+        return fill_stats(free_index.size(), Max_heap.size() - free_index.size());
+    }
+
+    const Defragment_report& defragment()
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        Defragment_report report;
+        counters.defragments++;
+
+        int cursor = 0;
+        Segment_List* last = &segment_head;
+        Segment_List* now = segment_head.next;
+        while (now)
+        {
+            Segment_List* tmp = now;
+            now = now->next;
+            Segment& seg = tmp->content;
+            if (!seg.status)
+            {
+                drop_free(tmp);
+                segment_index.erase(seg.first);
+                retire_id(seg.id);
+                tmp->prev->next = tmp->next;
+                if (tmp->next) tmp->next->prev = tmp->prev;
+                node_pool.destroy(tmp);
+                continue;
+            }
+            if (seg.first != cursor)
+            {
+                int size = seg.size();
+                if (storage) memmove(*storage + cursor, *storage + seg.first, size);
+                segment_index.erase(seg.first);
+                seg.first = cursor;
+                seg.end = cursor + size - 1;
+                segment_index[seg.first] = tmp;
+                if (relocate && tmp->owner) relocate(tmp->owner, seg.id, seg.first);
+                report.segments_moved++;
+                report.bytes_moved += size;
+            }
+            cursor = seg.end + 1;
+            last = tmp;
+        }
+
+        Max_heap = decltype(Max_heap)();
+        rover = nullptr; // the free nodes it may point at are gone
+        if (cursor < storage_size)
+        {
+            Segment_List* new_node = node_pool.create();
+            int id = new_id();
+            new_node->content = Segment(id, 0, cursor, storage_size - 1, 0, ++Modify[id]);
+            new_node->prev = last;
+            last->next = new_node;
+            segment_index[cursor] = new_node;
+            id_node[id] = new_node;
+            push_free(new_node);
+            rover = new_node;
+        }
+
+        report.time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        last_report = report;
+        if (Mem_op_print)
+            printf("defragment: %d segment(s), %d byte(s) moved, %.3f ms\n",
+                   report.segments_moved, report.bytes_moved, report.time_ms);
+        return last_report;
+    }
+};
+
+struct First_fit_policy
+{
+    template <class List>
+    static int decide(List& m, const int& size)
+    {
+        for (auto pnow = m.segment_head.next; pnow; pnow = pnow->next)
+            if (!pnow->content.status && pnow->content.size() >= size)
+                return pnow->content.first;
+        return -1;
+    }
+};
+
+struct Best_fit_policy
+{
+    template <class List>
+    static int decide(List& m, const int& size)
+    {
+        auto it = m.free_index.lower_bound(pair<int, int>(size, -1));
+        return it != m.free_index.end() ? it->second : -1;
+    }
+};
+
+struct Next_fit_policy
+{
+    template <class List>
+    static int decide(List& m, const int& size)
+    {
+        auto start = m.rover ? m.rover : m.segment_head.next;
+        auto pnow = start;
+        do
+        {
+            if (!pnow->content.status && pnow->content.size() >= size)
+                return pnow->content.first;
+            pnow = pnow->next ? pnow->next : m.segment_head.next; // wrap over the whole arena
+        } while (pnow != start);
+        return -1;
+    }
+};
+
+struct Worst_fit_policy
+{
+    template <class List>
+    static int decide(List& m, const int&)
+    {
+        return m.max_free()->first;
+    }
+};
+
+struct Segregated_fit_policy
+{
+    template <class List>
+    static int decide(List& m, const int& size)
+    {
+        int c = List::size_class(size);
+        auto pnow = m.bins[c];
+        for (int i = 0; pnow && i < BIN_SCAN_MAX; i++, pnow = pnow->bin_next)
+            if (pnow->content.size() >= size)
+                return pnow->content.first;
+        // every segment in a higher class fits
+        unsigned int higher = c + 1 < BIN_CNT ? m.bin_map & ~((2u << c) - 1) : 0;
+        if (higher) return m.bins[lowest_bit(higher)]->content.first;
+        // only long same-class bin left: finish the scan
+        for (; pnow; pnow = pnow->bin_next)
+            if (pnow->content.size() >= size)
+                return pnow->content.first;
+        return -1;
+    }
+};
+
+// an engine (tlsf, buddy, bitmap) behind the shared interface; engines place
+// blocks by their own rules and do not compact or restore
+template <class Engine>
+class Engine_simulator final : public Memory_simulator_base
+{
+private:
+    Engine engine;
+
+public:
+    using Memory_simulator_base::apply;
+
+    explicit Engine_simulator(const int& size = MEMORY_STORAGY): Memory_simulator_base(size), engine(size) {}
+
+    int apply(const int& size, int& id)
+    {
+        Time_point t0 = now_time();
+        int first = engine.apply(size, id);
+        if (!~first && size > 0 && expand_for(size)) first = engine.apply(size, id);
+        if (!~first) fprintf(stderr, "error: cannot alloc.\n");
+        note_apply(size, first, id, t0);
+        return first;
+    }
+
+    bool free(const int& id)
+    {
+        if (trace) trace->record(trace_free, 0, id);
+        Time_point t0 = now_time();
+        bool res = engine.free(id);
+        note_free(res, t0);
+        return res;
+    }
+
+    bool resize(const int& id, const int& size)
+    {
+        if (trace) trace->record(trace_resize, size, id);
+        return engine.resize(id, size);
+    }
+
+    int get_id(const int& locate) {return engine.get_id(locate);}
+    void show() {engine.show();}
+    int free_space() const {return engine.free_space();}
+    int largest_free() {return engine.largest_free();}
+    int segments() {return engine.segments();}
+
+    bool grow(const int& new_size)
+    {
+        if (new_size <= storage_size) return true;
+        if (!grow_storage(new_size) || !engine.grow(new_size)) return false;
+        storage_size = new_size;
+        if (Mem_op_print)
+            printf("grow: arena [0, %d]\n", storage_size - 1);
+        return true;
+    }
+
+    const Defragment_report& defragment()
+    {
+        last_report = Defragment_report();
+        return last_report;
+    }
+
+    Mem_stats stats() {return fill_stats(engine.free_segments(), -1);}
+    const Pool_stats& node_stats() const
+    {
+        static const Pool_stats none; // engines keep their blocks in side tables
+        return none;
+    }
+};
+
+// the strategy is picked per instance at construction; each call is one
+// virtual dispatch into the specialized simulator. use Basic_memory_simulator
+// or Engine_simulator directly when the strategy is known at compile time
+class Memory_simulator
+{
+public:
+    typedef Memory_simulator_base::Relocate_callback Relocate_callback;
+    typedef Memory_simulator_base::Defragment_report Defragment_report;
+    typedef Memory_simulator_base::Mem_stats Mem_stats;
+
+private:
+    Memory_simulator_base* impl;
+
+    static Memory_simulator_base* create(const Strategy& s, const int& size)
+    {
+        switch (s)
+        {
+            case best_fit: return new Basic_memory_simulator<Best_fit_policy>(size);
+            case next_fit: return new Basic_memory_simulator<Next_fit_policy>(size);
+            case worst_fit: return new Basic_memory_simulator<Worst_fit_policy>(size);
+            case segregated_fit: return new Basic_memory_simulator<Segregated_fit_policy>(size);
+            case tlsf: return new Engine_simulator<Tlsf_engine>(size);
+            case buddy: return new Engine_simulator<Buddy_engine>(size);
+            case bitmap: return new Engine_simulator<Bitmap_engine>(size);
+            case first_fit: break;
+        }
+        return new Basic_memory_simulator<First_fit_policy>(size);
+    }
+
+public:
+    explicit Memory_simulator(const int& size = MEMORY_STORAGY, const Strategy& s = strategy): impl(create(s, size)) {}
+    ~Memory_simulator() {delete impl;}
+    Memory_simulator(const Memory_simulator&) = delete;
+    Memory_simulator& operator = (const Memory_simulator&) = delete;
+
+    int apply(const int& size) {return impl->apply(size);}
+    int apply(const int& size, int& id) {return impl->apply(size, id);}
+    bool free(const int& id) {return impl->free(id);}
+    bool free_batch(const vector<int>& ids) {return impl->free_batch(ids);}
+    bool free_by_locate(const int& locate) {return impl->free_by_locate(locate);}
+    bool resize(const int& id, const int& size) {return impl->resize(id, size);}
+    int get_id(const int& locate) {return impl->get_id(locate);}
+    void show() {impl->show();}
+
+    void bind_storage(char** _storage, Relocate_callback _relocate, const int& limit = 0)
+    {
+        impl->bind_storage(_storage, _relocate, limit);
+    }
+    void set_owner(const int& id, void* owner) {impl->set_owner(id, owner);}
+    void set_zones(const int& boundary) {impl->set_zones(boundary);}
+    void set_trace(Trace_recorder* _trace) {impl->set_trace(_trace);}
+    void set_auto_compact(const bool& on) {impl->set_auto_compact(on);}
+    bool restore(const vector< pair<int, int> >& allocated, vector<int>& ids) {return impl->restore(allocated, ids);}
+
+    int capacity() const {return impl->capacity();}
+    bool grow(const int& new_size) {return impl->grow(new_size);}
+    bool expand_for(const int& size) {return impl->expand_for(size);}
+
+    int free_space() const {return impl->free_space();}
+    int largest_free() {return impl->largest_free();}
+    int segments() {return impl->segments();}
+    Mem_stats stats() {return impl->stats();}
+    const Pool_stats& node_stats() const {return impl->node_stats();}
+    const Defragment_report& defragment() {return impl->defragment();}
+    const Defragment_report& last_defragment() const {return impl->last_defragment();}
 };
 
 #endif /* _MEM_SIMULATOR_H_ */
\ No newline at end of file
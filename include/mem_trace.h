@@ -0,0 +1,131 @@
+/*mem_trace.h
+
+author: L1ttle-Q
+date: 2026-10-17
+
+allocator call trace
+
+a trace file is a Trace_header followed by fixed 16-byte Trace_records,
+one per Memory_simulator apply/free/resize call, in call order.
+handles are the ones the recording strategy returned; a replay maps them
+to its own. delta_ns is the time since the previous record (or since the
+recorder was opened), saturated at 2^32 - 1.
+*/
+
+#ifndef _MEM_TRACE_H_
+#define _MEM_TRACE_H_
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+enum Trace_op
+{
+    trace_apply,  // size requested, handle returned (-1 for a failure)
+    trace_free,   // handle released
+    trace_resize  // handle asked to resize in place to size
+};
+
+struct Trace_header
+{
+    char magic[8];
+    int arena; // arena bytes when recording started
+    int limit; // growth limit
+};
+
+struct Trace_record
+{
+    unsigned char op;
+    unsigned char pad[3];
+    int size;
+    int handle;
+    unsigned int delta_ns;
+};
+
+static const char TRACE_MAGIC[8] = "MTRACE1";
+
+class Trace_recorder
+{
+private:
+    static const int BUFFER_RECORDS = 4096;
+
+    FILE* out;
+    std::vector<Trace_record> buffer;
+    std::chrono::steady_clock::time_point last;
+
+    void flush()
+    {
+        if (out && !buffer.empty()) fwrite(buffer.data(), sizeof(Trace_record), buffer.size(), out);
+        buffer.clear();
+    }
+
+public:
+    Trace_recorder(): out(nullptr) {}
+    ~Trace_recorder() {close();}
+
+    bool open(const char* path, const int& arena, const int& limit)
+    {
+        close();
+        if (!(out = fopen(path, "wb")))
+        {
+            fprintf(stderr, "error: cannot write trace %s.\n", path);
+            return false;
+        }
+        Trace_header header;
+        memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+        header.arena = arena;
+        header.limit = limit;
+        fwrite(&header, sizeof(header), 1, out);
+        buffer.reserve(BUFFER_RECORDS);
+        last = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    void close()
+    {
+        flush();
+        if (out) fclose(out);
+        out = nullptr;
+    }
+
+    void record(const Trace_op& op, const int& size, const int& handle)
+    {
+        if (!out) return;
+        std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t - last).count();
+        last = t;
+        Trace_record rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.op = op;
+        rec.size = size;
+        rec.handle = handle;
+        rec.delta_ns = ns > 0xffffffffLL ? 0xffffffffu : (unsigned int)ns;
+        buffer.push_back(rec);
+        if ((int)buffer.size() >= BUFFER_RECORDS) flush();
+    }
+};
+
+// read a whole trace; false for a missing or malformed file
+inline bool load_trace(const char* path, Trace_header& header, std::vector<Trace_record>& records)
+{
+    FILE* in = fopen(path, "rb");
+    if (!in)
+    {
+        fprintf(stderr, "error: cannot read trace %s.\n", path);
+        return false;
+    }
+    bool ok = fread(&header, sizeof(header), 1, in) == 1 && !memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    records.clear();
+    Trace_record rec;
+    while (ok && fread(&rec, sizeof(rec), 1, in) == 1)
+    {
+        if (rec.op > trace_resize) {ok = false; break;}
+        records.push_back(rec);
+    }
+    fclose(in);
+    if (!ok) fprintf(stderr, "error: invalid trace %s.\n", path);
+    return ok;
+}
+
+#endif /* _MEM_TRACE_H_ */
@@ -0,0 +1,115 @@
+/*name_index.h
+
+author: L1ttle-Q
+date: 2026-10-17
+
+hash index of nodes by name
+
+open addressing with linear probing over a power-of-two table; each slot
+keeps a node index and its name hash, so a probe compares names only on a
+hash match. names are read off the owner (Names::name(key)), so a node must
+be erased before it is renamed and inserted again after. erased slots
+become tombstones, cleared by the next rehash; the table doubles past 1/2
+full (tombstones included) and is rebuilt in place when mostly tombstones.
+*/
+
+#ifndef _NAME_INDEX_H_
+#define _NAME_INDEX_H_
+
+#include <cstring>
+#include <vector>
+
+inline unsigned int name_hash(const char* s) // FNV-1a
+{
+    unsigned int h = 2166136261u;
+    while (*s) h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+template <class Names>
+class Name_index
+{
+private:
+    static const int EMPTY = -1;
+    static const int TOMBSTONE = -2;
+
+    struct Slot
+    {
+        int key; // node index, EMPTY or TOMBSTONE
+        unsigned int hash;
+    };
+
+    static const int MIN_CAPACITY = 64;
+
+    const Names* names;
+    std::vector<Slot> slots;
+    int used;   // live nodes
+    int filled; // live nodes and tombstones
+
+    void rehash(const int& capacity)
+    {
+        std::vector<Slot> old(capacity, Slot{EMPTY, 0});
+        old.swap(slots);
+        filled = used;
+        const unsigned int mask = slots.size() - 1;
+        for (const Slot& s : old)
+        {
+            if (s.key < 0) continue;
+            unsigned int i = s.hash & mask;
+            while (slots[i].key != EMPTY) i = (i + 1) & mask;
+            slots[i] = s;
+        }
+    }
+
+public:
+    explicit Name_index(const Names* _names):
+        names(_names), slots(MIN_CAPACITY, Slot{EMPTY, 0}), used(0), filled(0) {}
+
+    int size() const {return used;}
+    long long bytes() const {return sizeof(*this) + slots.capacity() * sizeof(Slot);}
+
+    // -1 when absent
+    int find(const char* name) const
+    {
+        const unsigned int h = name_hash(name), mask = slots.size() - 1;
+        for (unsigned int i = h & mask;; i = (i + 1) & mask)
+        {
+            const Slot& s = slots[i];
+            if (s.key == EMPTY) return -1;
+            if (s.key >= 0 && s.hash == h && !strcmp(names->name(s.key), name)) return s.key;
+        }
+    }
+
+    // key's name must not be indexed yet
+    void insert(const int& key)
+    {
+        if (2 * (filled + 1) > (int)slots.size())
+            rehash(2 * (used + 1) > (int)slots.size() / 2 ? slots.size() * 2 : slots.size());
+        const unsigned int h = name_hash(names->name(key)), mask = slots.size() - 1;
+        unsigned int i = h & mask;
+        while (slots[i].key >= 0) i = (i + 1) & mask;
+        if (slots[i].key == EMPTY) filled++; // a tombstone is reused as is
+        slots[i].key = key;
+        slots[i].hash = h;
+        used++;
+    }
+
+    // under key's current name
+    bool erase(const int& key)
+    {
+        const unsigned int h = name_hash(names->name(key)), mask = slots.size() - 1;
+        for (unsigned int i = h & mask;; i = (i + 1) & mask)
+        {
+            Slot& s = slots[i];
+            if (s.key == EMPTY) return false;
+            if (s.key == key)
+            {
+                s.key = TOMBSTONE;
+                used--;
+                return true;
+            }
+        }
+    }
+};
+
+#endif /* _NAME_INDEX_H_ */
@@ -0,0 +1,93 @@
+/*node_pool.h
+
+author: L1ttle-Q
+date: 2026-10-17
+
+fixed-size node pool
+
+nodes are carved out of CHUNK-sized blocks and recycled through an
+intrusive free list, so the hot paths reach the global heap once per
+CHUNK nodes at most. memory returns to the heap only with the pool.
+*/
+
+#ifndef _NODE_POOL_H_
+#define _NODE_POOL_H_
+
+#include <new>
+#include <vector>
+
+struct Pool_stats
+{
+    long long requests;    // nodes handed out
+    long long releases;    // nodes given back
+    long long heap_allocs; // chunks taken from the global heap
+    long long avoided() const {return requests - heap_allocs;}
+
+    Pool_stats(): requests(0), releases(0), heap_allocs(0) {}
+};
+
+template <typename T, int CHUNK = 256>
+class Node_pool
+{
+private:
+    union Slot
+    {
+        Slot* next;
+        alignas(T) unsigned char data[sizeof(T)];
+    };
+
+    std::vector<Slot*> chunks;
+    Slot* free_list;
+    Pool_stats stat;
+
+    void grow()
+    {
+        Slot* chunk = new Slot[CHUNK];
+        chunks.push_back(chunk);
+        stat.heap_allocs++;
+        for (int i = CHUNK - 1; i >= 0; i--)
+        {
+            chunk[i].next = free_list;
+            free_list = chunk + i;
+        }
+    }
+
+public:
+    Node_pool(): free_list(nullptr) {}
+    Node_pool(const Node_pool&) = delete;
+    Node_pool& operator = (const Node_pool&) = delete;
+    ~Node_pool()
+    {
+        for (Slot* chunk : chunks) delete[] chunk;
+    }
+
+    void* get() // raw storage for one T
+    {
+        if (!free_list) grow();
+        Slot* slot = free_list;
+        free_list = slot->next;
+        stat.requests++;
+        return slot;
+    }
+
+    void put(void* p)
+    {
+        if (!p) return;
+        Slot* slot = static_cast<Slot*>(p);
+        slot->next = free_list;
+        free_list = slot;
+        stat.releases++;
+    }
+
+    T* create() {return new (get()) T();}
+    void destroy(T* p)
+    {
+        if (!p) return;
+        p->~T();
+        put(p);
+    }
+
+    const Pool_stats& stats() const {return stat;}
+};
+
+#endif /* _NODE_POOL_H_ */
@@ -0,0 +1,300 @@
+/*tlsf_engine.h
+
+author: L1ttle-Q
+date: 2026-10-17
+
+two-level segregated fit engine
+
+first level: floor(log2(size)), second level: SL_CNT linear slices of it.
+a bitmap per level finds a non-empty free list with two bit scans, so
+apply and free are O(1) whatever the fragmentation.
+the search rounds the request up to the next slice ("good fit"), so a
+block slightly larger than the request but in the same slice is skipped.
+
+block metadata lives in a side table keyed by the block's first offset
+(block header bytes would change what the simulated arena holds), so it
+grows with the number of blocks, not with the arena; the handle of a
+block is its first offset.
+*/
+
+#ifndef _TLSF_ENGINE_H_
+#define _TLSF_ENGINE_H_
+
+#include <cstdio>
+#include <unordered_map>
+
+#include "mem_engine.h"
+
+extern bool Mem_op_print;
+
+class Tlsf_engine : public Memory_engine
+{
+private:
+    static const int SL_BITS = 4;
+    static const int SL_CNT = 1 << SL_BITS;
+    static const int FL_CNT = 32 - SL_BITS + 1;
+
+    struct Block
+    {
+        int size;
+        int prev_phys; // first of the physically previous block, -1 for none
+        int free_prev;
+        int free_next;
+        bool used;
+    };
+
+    int storage_size;
+    int free_size;
+    int block_cnt; // blocks in the arena, allocated and free
+    int free_cnt;  // blocks in the free lists
+    std::unordered_map<int, Block> blocks; // block starts only
+
+    unsigned int fl_bitmap;
+    unsigned int sl_bitmap[FL_CNT];
+    int heads[FL_CNT][SL_CNT];
+
+    Block* block_at(const int& first) // nullptr if no block starts there
+    {
+        std::unordered_map<int, Block>::iterator it = blocks.find(first);
+        return it == blocks.end() ? nullptr : &it->second;
+    }
+
+    static void mapping_insert(const int& size, int& fl, int& sl)
+    {
+        if (size < SL_CNT)
+        {
+            fl = 0;
+            sl = size;
+            return;
+        }
+        int f = highest_bit((unsigned int)size);
+        sl = (size >> (f - SL_BITS)) ^ SL_CNT;
+        fl = f - SL_BITS + 1;
+    }
+
+    static void mapping_search(int size, int& fl, int& sl)
+    {
+        if (size >= SL_CNT)
+            size += (1 << (highest_bit((unsigned int)size) - SL_BITS)) - 1;
+        mapping_insert(size, fl, sl);
+    }
+
+    void insert_block(const int& first)
+    {
+        int fl, sl;
+        mapping_insert(blocks[first].size, fl, sl);
+        Block& b = blocks[first];
+        b.used = false;
+        b.free_prev = -1;
+        b.free_next = heads[fl][sl];
+        if (~heads[fl][sl]) blocks[heads[fl][sl]].free_prev = first;
+        heads[fl][sl] = first;
+        fl_bitmap |= 1u << fl;
+        sl_bitmap[fl] |= 1u << sl;
+        free_cnt++;
+    }
+
+    void remove_block(const int& first)
+    {
+        int fl, sl;
+        mapping_insert(blocks[first].size, fl, sl);
+        Block& b = blocks[first];
+        if (~b.free_prev) blocks[b.free_prev].free_next = b.free_next;
+        else heads[fl][sl] = b.free_next;
+        if (~b.free_next) blocks[b.free_next].free_prev = b.free_prev;
+        if (!~heads[fl][sl])
+        {
+            sl_bitmap[fl] &= ~(1u << sl);
+            if (!sl_bitmap[fl]) fl_bitmap &= ~(1u << fl);
+        }
+        free_cnt--;
+    }
+
+    int find_suitable(const int& size)
+    {
+        int fl, sl;
+        mapping_search(size, fl, sl);
+        if (fl >= FL_CNT) return -1;
+        unsigned int sl_map = sl_bitmap[fl] & (~0u << sl);
+        if (!sl_map)
+        {
+            unsigned int fl_map = fl + 1 < FL_CNT ? fl_bitmap & (~0u << (fl + 1)) : 0;
+            if (!fl_map) return -1;
+            fl = lowest_bit(fl_map);
+            sl_map = sl_bitmap[fl];
+        }
+        return heads[fl][lowest_bit(sl_map)];
+    }
+
+    // absorb the physically next block (free) into first
+    void absorb_next(const int& first)
+    {
+        int next = first + blocks[first].size;
+        blocks[first].size += blocks[next].size;
+        blocks.erase(next);
+        block_cnt--;
+        int after = first + blocks[first].size;
+        if (after < storage_size) blocks[after].prev_phys = first;
+    }
+
+public:
+    explicit Tlsf_engine(const int& _storage_size):
+        storage_size(_storage_size), free_size(_storage_size), block_cnt(1), free_cnt(0), fl_bitmap(0)
+    {
+        for (int fl = 0; fl < FL_CNT; fl++)
+        {
+            sl_bitmap[fl] = 0;
+            for (int sl = 0; sl < SL_CNT; sl++) heads[fl][sl] = -1;
+        }
+        blocks[0].size = storage_size;
+        blocks[0].prev_phys = -1;
+        insert_block(0);
+    }
+
+    int apply(const int& size, int& id)
+    {
+        id = -1;
+        if (size <= 0) return -1;
+        int first = find_suitable(size);
+        if (!~first) return -1;
+
+        remove_block(first);
+        if (blocks[first].size > size)
+        {
+            int rest = first + size;
+            blocks[rest].size = blocks[first].size - size;
+            blocks[rest].prev_phys = first;
+            int after = rest + blocks[rest].size;
+            if (after < storage_size) blocks[after].prev_phys = rest;
+            blocks[first].size = size;
+            block_cnt++;
+            insert_block(rest);
+        }
+        blocks[first].used = true;
+        free_size -= size;
+
+        if (Mem_op_print)
+            printf("alloc: id: %d, range[%d, %d]\n", first, first, first + size - 1);
+        id = first;
+        return first;
+    }
+
+    bool free(const int& id)
+    {
+        const Block* b = block_at(id);
+        if (!b || !b->used)
+        {
+            fprintf(stderr, "error: cannot free.\n");
+            return false;
+        }
+        int first = id;
+        free_size += blocks[first].size;
+        if (Mem_op_print)
+            printf("free: id: %d, range[%d, %d] size: %d\n", first, first, first + blocks[first].size - 1, blocks[first].size);
+
+        int next = first + blocks[first].size;
+        if (next < storage_size && !blocks[next].used)
+        {
+            remove_block(next);
+            absorb_next(first);
+        }
+        int prev = blocks[first].prev_phys;
+        if (~prev && !blocks[prev].used)
+        {
+            remove_block(prev);
+            absorb_next(prev);
+            first = prev;
+        }
+        insert_block(first);
+        return true;
+    }
+
+    bool resize(const int& id, const int& size)
+    {
+        const Block* b = block_at(id);
+        if (!b || !b->used || size <= 0) return false;
+        int first = id;
+        int cur = blocks[first].size;
+        if (size > cur)
+        {
+            int next = first + cur;
+            if (next >= storage_size || blocks[next].used || cur + blocks[next].size < size) return false;
+            remove_block(next);
+            absorb_next(first);
+        }
+        if (blocks[first].size > size) // give the tail back, joined with a free neighbour
+        {
+            int rest = first + size;
+            blocks[rest].size = blocks[first].size - size;
+            blocks[rest].prev_phys = first;
+            blocks[first].size = size;
+            block_cnt++;
+            int after = rest + blocks[rest].size;
+            if (after < storage_size)
+            {
+                blocks[after].prev_phys = rest;
+                if (!blocks[after].used)
+                {
+                    remove_block(after);
+                    absorb_next(rest);
+                }
+            }
+            insert_block(rest);
+        }
+        free_size -= size - cur;
+        return true;
+    }
+
+    bool grow(const int& new_size)
+    {
+        if (new_size <= storage_size) return new_size == storage_size;
+        int last = 0;
+        while (last + blocks[last].size < storage_size) last += blocks[last].size;
+        int first = storage_size;
+        blocks[first].size = new_size - storage_size;
+        blocks[first].prev_phys = last;
+        block_cnt++;
+        free_size += new_size - storage_size;
+        storage_size = new_size;
+        if (!blocks[last].used)
+        {
+            remove_block(last);
+            absorb_next(last);
+            first = last;
+        }
+        insert_block(first);
+        return true;
+    }
+
+    int get_id(const int& locate)
+    {
+        if (locate < 0 || locate >= storage_size)
+            return -1;
+        if (block_at(locate)) return locate;
+        for (int first = 0; first < storage_size; first += blocks[first].size) // interior offset
+            if (locate < first + blocks[first].size) return first;
+        return -1;
+    }
+
+    int free_space() const {return free_size;}
+    int largest_free() // lower bound of the highest non-empty slice: the search lands on that slice
+    {
+        if (!fl_bitmap) return 0;
+        int fl = highest_bit(fl_bitmap);
+        int sl = highest_bit(sl_bitmap[fl]);
+        return fl ? (SL_CNT + sl) << (fl - 1) : sl;
+    }
+
+    int segments() const {return block_cnt;}
+    int free_segments() const {return free_cnt;}
+
+    void show()
+    {
+        printf("Memory Assignment: (tlsf)\n");
+        for (int first = 0; first < storage_size; first += blocks[first].size)
+            printf("segment %d: [%d, %d], size: %d, status: %s\n",
+                   first, first, first + blocks[first].size - 1, blocks[first].size, blocks[first].used ? "allocated" : "free");
+    }
+};
+
+#endif /* _TLSF_ENGINE_H_ */
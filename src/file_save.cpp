@@ -20,6 +20,10 @@ reserved -> ;[]()"{}
 */
 
 #include <cstring>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
 #include "file_save.h"
 #include "file_simulator.h"
 
@@ -81,58 +85,92 @@ bool valid_ch(const char& c)
     return !Reserved(c);
 }
 
-void File_simulator_constructor::SetFolderAttr(File_simulator* p, const char* name, const time_t ctime, const time_t mtime, const int rwx)
+// a saved name is one path component
+bool valid_name(const char* name)
 {
-    folder_control_block* cur = p->now;
-    if (cur == &p->root_folder && strcmp(name, "")) fprintf(stderr, "warning: root folder can not be renamed.(saved file has been changed)\n");
-    else cur->modify_name(name);
-    cur->modify_ctime(ctime);
-    cur->modify_mtime(mtime);
-    cur->modify_rwx(rwx);
+    return !strchr(name, '/') && strcmp(name, ".") && strcmp(name, "..");
 }
 
-void File_simulator_constructor::SetFileAttr(File_simulator* p, const char* name, const time_t ctime, const time_t mtime, const int rwx)
+bool File_simulator_constructor::SetFolderAttr(File_simulator* p, const char* name, const time_t ctime, const time_t mtime, const int rwx)
 {
-    file_control_block* p_file = p->find_file(name, p->now);
-    p_file->modify_ctime(ctime);
-    p_file->modify_mtime(mtime);
-    p_file->modify_rwx(rwx);
+    Inode_table& inodes = *File_simulator::inodes;
+    int cur = p->now;
+    if (cur == p->root_folder && strcmp(name, "")) fprintf(stderr, "warning: root folder can not be renamed.(saved file has been changed)\n");
+    else if (cur != p->root_folder)
+    {
+        if (!*name || ~inodes.lookup(inodes[cur].parent, name))
+        {
+            fprintf(stderr, "error: invalid saved file.(empty or duplicate name %s)\n", name);
+            return false;
+        }
+        inodes.rename(cur, name);
+    }
+    inodes[cur].ctime = ctime;
+    inodes[cur].mtime = mtime;
+    inodes[cur].rwx = rwx;
+    return true;
+}
+
+// give the file created as tmp in the current folder its saved name
+bool File_simulator_constructor::SetFileName(File_simulator* p, const char* tmp, const char* name)
+{
+    Inode_table& inodes = *File_simulator::inodes;
+    int p_file = inodes.lookup(p->now, tmp);
+    if (!~p_file) return false;
+    if (!*name || ~inodes.lookup(p->now, name))
+    {
+        fprintf(stderr, "error: invalid saved file.(empty or duplicate name %s)\n", name);
+        return false;
+    }
+    inodes.rename(p_file, name);
+    return true;
+}
+
+bool File_simulator_constructor::SetFileAttr(File_simulator* p, const char* name, const time_t ctime, const time_t mtime, const int rwx)
+{
+    Inode_table& inodes = *File_simulator::inodes;
+    int p_file = inodes.lookup(p->now, name);
+    if (!~p_file || !inodes[p_file].is_file()) return false;
+    inodes[p_file].ctime = ctime;
+    inodes[p_file].mtime = mtime;
+    inodes[p_file].rwx = rwx;
+    return true;
 }
 void File_simulator_constructor::Setrwx(File_simulator *p, const int rwx)
 {
-    folder_control_block* cur = p->now;
-    cur->modify_rwx(rwx);
+    (*File_simulator::inodes)[p->now].rwx = rwx;
 }
-void File_simulator_constructor::SaveSimulator(folder_control_block* cur)
+void File_simulator_constructor::SaveSimulator(const int& cur)
 {
-    fprintf(FILE_OSTREAM, "[%s;%lld;%lld;%d]", cur->get_name(), cur->get_ctime(), cur->get_mtime(), cur->get_rwx());
+    const Inode_table& inodes = *File_simulator::inodes;
+    fprintf(FILE_OSTREAM, "[%s;%lld;%lld;%d]", inodes.name(cur), (long long)inodes[cur].ctime, (long long)inodes[cur].mtime, inodes[cur].rwx);
     fprintf(FILE_OSTREAM, "{");
-    basic_block* ch = cur->ch;
-    while (ch)
+    for (int ch = inodes[cur].folder.child; ~ch; ch = inodes[ch].sibling)
     {
-        if (dynamic_cast<folder_control_block*>(ch))
-            SaveSimulator(dynamic_cast<folder_control_block*>(ch));
+        const Inode& node = inodes[ch];
+        if (node.is_folder())
+            SaveSimulator(ch);
         else
         {
-            file_control_block* p_file = dynamic_cast<file_control_block*>(ch);
-            fprintf(FILE_OSTREAM, "(%s;%lld;%lld;%d)", ch->get_name(), ch->get_ctime(), ch->get_mtime(), ch->get_rwx());
+            fprintf(FILE_OSTREAM, "(%s;%lld;%lld;%d)", inodes.name(ch), (long long)node.ctime, (long long)node.mtime, node.rwx);
             fprintf(FILE_OSTREAM, "\"");
-            char* tmp_c = File_simulator::MEMORY + p_file->pfile;
-            for (int i = 0; i < p_file->size; i++)
+            for (int k = node.file.extent; ~k; k = inodes.extent(k).next)
             {
-                if (Reserved(*tmp_c)) fprintf(FILE_OSTREAM, "\\");
-                fprintf(FILE_OSTREAM, "%c", *tmp_c++);
+                char* tmp_c = File_simulator::MEMORY + inodes.extent(k).first;
+                for (int i = 0; i < inodes.extent(k).size; i++)
+                {
+                    if (Reserved(*tmp_c)) fprintf(FILE_OSTREAM, "\\");
+                    fprintf(FILE_OSTREAM, "%c", *tmp_c++);
+                }
             }
             fprintf(FILE_OSTREAM, "\"");
         }
-        ch = ch->sibling;
     }
     fprintf(FILE_OSTREAM, "}");
 }
 void File_simulator_constructor::SaveSimulator(File_simulator *p)
 {
-    folder_control_block* cur = &p->root_folder;
-    SaveSimulator(cur);
+    SaveSimulator(p->root_folder);
 }
 
 File_simulator_constructor constructor;
@@ -142,6 +180,243 @@ void SaveSimulator(File_simulator* p)
     constructor.SaveSimulator(p);
 }
 
+// image metadata records, native layout: the file is read back by the same build
+struct Image_header
+{
+    char magic[8];
+    int version;
+    int arena;
+    int node_cnt;
+    int extent_cnt;
+    long long generation; // equals the image file's while its arena bytes are the ones described
+};
+struct Image_node
+{
+    char name[MAX_NAME_LENGTH];
+    long long ctime, mtime;
+    int rwx;
+    int folder;
+    int child_cnt; // folders only
+    int size;      // files only
+    int extent_cnt;
+};
+struct Image_extent
+{
+    int first;
+    int size;
+};
+static const char IMAGE_MAGIC[8] = "FSIMAGE";
+static const int IMAGE_VERSION = 2;
+
+bool File_simulator_constructor::SaveImage(File_simulator* p, const char* path)
+{
+    std::vector<Image_node> nodes;
+    std::vector<Image_extent> extents;
+    const Inode_table& inodes = *File_simulator::inodes;
+    std::vector<int> stack(1, p->root_folder);
+    std::vector<int> children;
+    while (!stack.empty())
+    {
+        int cur = stack.back();
+        stack.pop_back();
+        const Inode& inode = inodes[cur];
+        Image_node node;
+        memset(&node, 0, sizeof(node));
+        strncpy(node.name, inodes.name(cur), MAX_NAME_LENGTH - 1);
+        node.ctime = inode.ctime;
+        node.mtime = inode.mtime;
+        node.rwx = inode.rwx;
+        if (inode.is_folder())
+        {
+            node.folder = 1;
+            children.clear();
+            for (int ch = inode.folder.child; ~ch; ch = inodes[ch].sibling)
+                children.push_back(ch);
+            node.child_cnt = children.size();
+            stack.insert(stack.end(), children.rbegin(), children.rend()); // preorder, saved order
+        }
+        else
+        {
+            node.size = inode.size;
+            node.extent_cnt = inode.file.extent_cnt;
+            for (int k = inode.file.extent; ~k; k = inodes.extent(k).next)
+                extents.push_back(Image_extent{inodes.extent(k).first, inodes.extent(k).size});
+        }
+        nodes.push_back(node);
+    }
+
+    if (!arena_sync(File_simulator::MEMORY, File_simulator::mem->capacity()))
+    {
+        fprintf(stderr, "error: cannot sync image %s.\n", path);
+        return false;
+    }
+    Image_header header;
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+    header.version = IMAGE_VERSION;
+    header.arena = File_simulator::mem->capacity();
+    header.node_cnt = nodes.size();
+    header.extent_cnt = extents.size();
+    header.generation = arena_file_generation(); // already moved past the old .meta if any byte changed
+
+    // write aside and rename, so a crash leaves the previous metadata intact
+    std::string meta = std::string(path) + ".meta", tmp = meta + ".tmp";
+    FILE* out = fopen(tmp.c_str(), "wb");
+    if (!out)
+    {
+        fprintf(stderr, "error: cannot write %s.\n", tmp.c_str());
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    if (ok && !nodes.empty()) ok = fwrite(nodes.data(), sizeof(Image_node), nodes.size(), out) == nodes.size();
+    if (ok && !extents.empty()) ok = fwrite(extents.data(), sizeof(Image_extent), extents.size(), out) == extents.size();
+    if (fclose(out) || !ok || rename(tmp.c_str(), meta.c_str()))
+    {
+        fprintf(stderr, "error: cannot write %s.\n", meta.c_str());
+        return false;
+    }
+    File_simulator::image_clean = true;
+    return true;
+}
+
+bool File_simulator_constructor::LoadImage(File_simulator* p, const char* path)
+{
+    std::string meta = std::string(path) + ".meta";
+    FILE* in = fopen(meta.c_str(), "rb");
+    if (!in)
+    {
+        if (arena_file_generation()) // written to, but its metadata is gone
+        {
+            fprintf(stderr, "error: invalid image %s.(no %s)\n", path, meta.c_str());
+            return false;
+        }
+        File_simulator::image_clean = true; // new image, nothing saved yet
+        return true;
+    }
+    std::vector<char> data;
+    if (!fseek(in, 0, SEEK_END))
+    {
+        long len = ftell(in);
+        if (len > 0 && !fseek(in, 0, SEEK_SET))
+        {
+            data.resize(len);
+            if (fread(data.data(), 1, len, in) != (size_t)len) data.clear();
+        }
+    }
+    fclose(in);
+
+    Image_header header;
+    if (data.size() < sizeof(header))
+    {
+        fprintf(stderr, "error: invalid image %s.(truncated)\n", meta.c_str());
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if (memcmp(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) || header.version != IMAGE_VERSION ||
+        header.node_cnt <= 0 || header.extent_cnt < 0 ||
+        data.size() != sizeof(header) + (size_t)header.node_cnt * sizeof(Image_node) + (size_t)header.extent_cnt * sizeof(Image_extent))
+    {
+        fprintf(stderr, "error: invalid image %s.(bad header)\n", meta.c_str());
+        return false;
+    }
+    if (header.generation != arena_file_generation())
+    {
+        fprintf(stderr, "error: invalid image %s.(arena changed after the last sync)\n", meta.c_str());
+        return false;
+    }
+    const Image_node* nodes = reinterpret_cast<const Image_node*>(data.data() + sizeof(header));
+    const Image_extent* extents = reinterpret_cast<const Image_extent*>(nodes + header.node_cnt);
+
+    // check the shape before anything is built: every folder's children are present
+    // and the files own exactly the saved extents, at least one each
+    std::vector<int> remain(1, nodes[0].child_cnt);
+    bool bad = !nodes[0].folder || nodes[0].child_cnt < 0;
+    int extent_cnt = 0;
+    for (int i = 1; i < header.node_cnt && !bad; i++)
+    {
+        while (!remain.empty() && !remain.back()) remain.pop_back();
+        if (remain.empty() || nodes[i].child_cnt < 0 || nodes[i].extent_cnt < 0) {bad = true; break;}
+        remain.back()--;
+        if (nodes[i].folder) {remain.push_back(nodes[i].child_cnt); continue;}
+        if (!nodes[i].extent_cnt || nodes[i].extent_cnt > header.extent_cnt - extent_cnt) {bad = true; break;}
+        long long sum = 0;
+        for (int k = 0; k < nodes[i].extent_cnt; k++) sum += extents[extent_cnt + k].size;
+        if (sum != nodes[i].size) bad = true;
+        extent_cnt += nodes[i].extent_cnt;
+    }
+    while (!remain.empty() && !remain.back()) remain.pop_back();
+    if (bad || !remain.empty() || extent_cnt != header.extent_cnt)
+    {
+        fprintf(stderr, "error: invalid image %s.(bad tree)\n", meta.c_str());
+        return false;
+    }
+
+    // claim the saved segments in address order; the bytes are already in place
+    std::vector< std::pair<int, int> > order(header.extent_cnt);
+    for (int i = 0; i < header.extent_cnt; i++) order[i] = std::make_pair(extents[i].first, i);
+    std::sort(order.begin(), order.end());
+    std::vector< std::pair<int, int> > allocated(header.extent_cnt);
+    for (int i = 0; i < header.extent_cnt; i++)
+        allocated[i] = std::make_pair(extents[order[i].second].first, extents[order[i].second].size);
+    std::vector<int> sorted_ids, ids(header.extent_cnt);
+    if (!File_simulator::mem->restore(allocated, sorted_ids))
+    {
+        fprintf(stderr, "error: invalid image %s.(bad extents)\n", meta.c_str());
+        return false;
+    }
+    for (int i = 0; i < header.extent_cnt; i++) ids[order[i].second] = sorted_ids[i];
+
+    Inode_table& inodes = *File_simulator::inodes;
+    const int root = p->root_folder;
+    inodes[root].ctime = nodes[0].ctime;
+    inodes[root].mtime = nodes[0].mtime;
+    inodes[root].rwx = nodes[0].rwx;
+    struct Level
+    {
+        int folder;
+        int tail;
+        int remain;
+    };
+    std::vector<Level> levels(1, Level{root, -1, nodes[0].child_cnt});
+    int next_extent = 0;
+    for (int i = 1; i < header.node_cnt; i++)
+    {
+        while (!levels.back().remain) levels.pop_back();
+        levels.back().remain--;
+        char name[MAX_NAME_LENGTH];
+        memcpy(name, nodes[i].name, MAX_NAME_LENGTH);
+        name[MAX_NAME_LENGTH - 1] = '\0';
+
+        int block = inodes.create(name, nodes[i].folder ? kind_folder : kind_file, nodes[i].ctime, nodes[i].rwx);
+        if (!nodes[i].folder)
+        {
+            for (int k = 0; k < nodes[i].extent_cnt; k++, next_extent++)
+            {
+                int e = inodes.add_extent(block, extents[next_extent].first, ids[next_extent], extents[next_extent].size);
+                File_simulator::mem->set_owner(ids[next_extent], File_simulator::extent_owner(e));
+            }
+            inodes[block].size = nodes[i].size;
+        }
+        inodes[block].mtime = nodes[i].mtime;
+        Level& level = levels.back();
+        inodes.add_child(level.folder, block, level.tail);
+        level.tail = block;
+        if (nodes[i].folder && nodes[i].child_cnt > 0)
+            levels.push_back(Level{block, -1, nodes[i].child_cnt});
+    }
+    File_simulator::image_clean = true;
+    return true;
+}
+
+bool SaveImage(File_simulator* p, const char* path)
+{
+    return constructor.SaveImage(p, path);
+}
+
+bool LoadImage(File_simulator* p, const char* path)
+{
+    return constructor.LoadImage(p, path);
+}
+
 bool fdcb(File_simulator* now, int& rwx)
 {
     static char name[MAX_NAME_LENGTH];
@@ -159,9 +434,19 @@ bool fdcb(File_simulator* now, int& rwx)
             fprintf(stderr, "error: invalid saved file.(name with reserved character)\n");
             return false;
         }
+        if (idx_name == MAX_NAME_LENGTH - 1)
+        {
+            fprintf(stderr, "error: invalid saved file.(name too long)\n");
+            return false;
+        }
         name[idx_name++] = c;
         move_ahead(); c = getNextChar();
     } name[idx_name++] = '\0'; match(';'); c = getNextChar();
+    if (!valid_name(name))
+    {
+        fprintf(stderr, "error: invalid saved file.(name %s is not a single path component)\n", name);
+        return false;
+    }
     while (c != ';')
     {
         if (!isdigit(c))
@@ -192,8 +477,7 @@ bool fdcb(File_simulator* now, int& rwx)
         rwx = (rwx << 3) + (rwx << 1) + c - '0';
         move_ahead(); c = getNextChar();
     } match(']');
-    constructor.SetFolderAttr(now, name, ctime, mtime, 0777);
-    return true;
+    return constructor.SetFolderAttr(now, name, ctime, mtime, 0777);
 }
 
 bool fcb(File_simulator* now, char* name, time_t& mtime, time_t& ctime, int& rwx)
@@ -212,9 +496,19 @@ bool fcb(File_simulator* now, char* name, time_t& mtime, time_t& ctime, int& rwx
             fprintf(stderr, "error: invalid saved file.(name with reserved character)\n");
             return false;
         }
+        if (idx_name == MAX_NAME_LENGTH - 1)
+        {
+            fprintf(stderr, "error: invalid saved file.(name too long)\n");
+            return false;
+        }
         name[idx_name++] = c;
         move_ahead(); c = getNextChar();
     } name[idx_name++] = '\0'; match(';'); c = getNextChar();
+    if (!valid_name(name))
+    {
+        fprintf(stderr, "error: invalid saved file.(name %s is not a single path component)\n", name);
+        return false;
+    }
     while (c != ';')
     {
         if (!isdigit(c))
@@ -245,21 +539,20 @@ bool fcb(File_simulator* now, char* name, time_t& mtime, time_t& ctime, int& rwx
         rwx = (rwx << 3) + (rwx << 1) + c - '0';
         move_ahead(); c = getNextChar();
     } match(')'); c = getNextChar();
-    now->rename(";tmpfile", name);
-    return true;
+    return constructor.SetFileName(now, ";tmpfile", name);
 }
 
-bool E(char*, int&);
-bool C(char*, int&);
+bool E(std::string&);
+bool C(std::string&);
 bool G(File_simulator*);
 bool A(File_simulator*);
 bool B(File_simulator*);
 
-bool E(char* content, int& idx)
+bool E(std::string& content)
 {
     char c = getNextChar();
-    if (!Reserved(c)) {move_ahead(); content[idx++] = c;}
-    else if (c == '\\') {move_ahead(); c = getNextChar(); move_ahead(); content[idx++] = c;}
+    if (!Reserved(c)) {move_ahead(); content.push_back(c);}
+    else if (c == '\\') {move_ahead(); c = getNextChar(); move_ahead(); content.push_back(c);}
     else
     {
         fprintf(stderr, "error: invalid saved file.(reserved character exists without \'\\\')\n");
@@ -268,16 +561,14 @@ bool E(char* content, int& idx)
     return true;
 }
 
-bool C(char* content, int& idx)
+bool C(std::string& content)
 {
     char c = getNextChar();
     while (c != '\"')
     {
-        if (!E(content, idx)) return false;
+        if (!E(content)) return false;
         c = getNextChar();
     }
-
-    content[idx++] = '\0';
     return true;
 }
 
@@ -334,16 +625,14 @@ bool B(File_simulator* now)
     static char name[MAX_NAME_LENGTH];
     time_t ctime, mtime;
     int rwx;
-    static char content[MEMORY_STORAGY];
-    static int len_content;
+    static std::string content; // any size the arena can grow to
 
-    len_content = 0;
+    content.clear();
     now->create(";tmpfile");
     if (!fcb(now, name, ctime, mtime, rwx)) return false;
     match('\"');
-    if (!C(content, len_content)) return false;
+    if (!C(content)) return false;
     match('\"');
-    now->write(name, content);
-    constructor.SetFileAttr(now, name, ctime, mtime, rwx);
-    return true;
+    now->write(name, content.c_str());
+    return constructor.SetFileAttr(now, name, ctime, mtime, rwx);
 }
@@ -6,7 +6,9 @@ update: 2025-6-9
 
 */
 
+#include <cerrno>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <string>
 #include <cmath>
@@ -27,21 +29,25 @@ using namespace file_simulator_operation;
 // input
 const int BUF_MAX = 256;
 const string OperationStr[] = {"tree", "treeall", "pwd", "ls", "create", "write", "read", "mkdir",
-                               "delete", "deldir", "append", "cp", "rename", "chmod", "cd", "export", "import", "exit"};
+                               "delete", "deldir", "append", "cp", "rename", "chmod", "cd", "export", "import", "defrag", "memstat", "sync", "exit"};
 char buf[BUF_MAX * 3];
 std::map<string, int> OperationDict;
 
 // memory simulator
 Strategy strategy = first_fit;
 bool Mem_op_print = false;
+int arena_size = MEMORY_STORAGY;
+int arena_limit = 1 << 30;
+const char* arena_image = nullptr;
+int arena_zones = 0;
+Trace_recorder* mem_trace = nullptr;
 
 // file simulator
-file_control_block::~file_control_block()
-{
-    File_simulator::mem->free_by_locate(pfile);
-}
 Memory_simulator* File_simulator::mem = nullptr;
 char* File_simulator::MEMORY = nullptr;
+Inode_table* File_simulator::inodes = nullptr;
+bool File_simulator::image_clean = false;
+long long image_defragments = 0; // compactions already covered by the image's .meta
 
 File_simulator* file_simulator;
 // file save
@@ -72,18 +78,128 @@ void Make_saved_dir()
     printf("created dir %s (ignore if exists)\n", addr_saved);
 }
 
-void Init()
+// bytes with an optional K/M/G suffix; -1 for invalid
+int parse_size(const char* s)
+{
+    char* end;
+    errno = 0;
+    long long res = strtoll(s, &end, 10);
+    int shift = 0;
+    if (*end == 'K' || *end == 'k') shift = 10, end++;
+    else if (*end == 'M' || *end == 'm') shift = 20, end++;
+    else if (*end == 'G' || *end == 'g') shift = 30, end++;
+    // bound before shifting, a wrapped value could land back in range
+    if (errno == ERANGE || end == s || *end || res <= 0 || res > ((1 << 30) >> shift)) return -1;
+    return (int)(res << shift);
+}
+
+const char* StrategyStr[] = {"first", "best", "next", "worst", "segregated", "tlsf", "buddy", "bitmap"};
+const char* StrategyName[] = {"first fit", "best fit", "next fit", "worst fit", "segregated fit", "tlsf", "buddy", "bitmap"};
+constexpr int len_strategyStr = sizeof(StrategyStr) / sizeof(StrategyStr[0]);
+
+// tlsf, buddy and bitmap keep their own block tables: no restore, no zones
+bool is_engine(const Strategy& s)
+{
+    return s == tlsf || s == buddy || s == bitmap;
+}
+
+// --arena <size>     arena bytes at startup (env FILE_SIMULATOR_ARENA)
+// --arena-max <size> growth limit (env FILE_SIMULATOR_ARENA_MAX)
+// --image <path>     map the arena from path and keep the tree in path.meta (env FILE_SIMULATOR_IMAGE), segment-list strategies only
+// --trace <path>     record allocator calls for mem_replay (env FILE_SIMULATOR_TRACE)
+// --strategy <name>  first, best, next, worst, segregated, tlsf, buddy or bitmap (env FILE_SIMULATOR_STRATEGY)
+// --zones <size>     place requests above size apart from small files (env FILE_SIMULATOR_ZONES), segment-list strategies only
+bool Parse_args(int argc, char** argv)
+{
+    arena_image = getenv("FILE_SIMULATOR_IMAGE");
+    const char* opt_trace = getenv("FILE_SIMULATOR_TRACE");
+    const char* opt_strategy = getenv("FILE_SIMULATOR_STRATEGY");
+    const char* env_size = getenv("FILE_SIMULATOR_ARENA");
+    const char* env_limit = getenv("FILE_SIMULATOR_ARENA_MAX");
+    const char* opt_zones = getenv("FILE_SIMULATOR_ZONES");
+    const char* opt_size = env_size;
+    const char* opt_limit = env_limit;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--arena") && i + 1 < argc) opt_size = argv[++i];
+        else if (!strcmp(argv[i], "--arena-max") && i + 1 < argc) opt_limit = argv[++i];
+        else if (!strcmp(argv[i], "--image") && i + 1 < argc) arena_image = argv[++i];
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc) opt_trace = argv[++i];
+        else if (!strcmp(argv[i], "--strategy") && i + 1 < argc) opt_strategy = argv[++i];
+        else if (!strcmp(argv[i], "--zones") && i + 1 < argc) opt_zones = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [--arena <size>] [--arena-max <size>] [--image <path>] [--trace <path>] [--strategy <name>] [--zones <size>]\n", argv[0]);
+            return false;
+        }
+    }
+    if (opt_size && (arena_size = parse_size(opt_size)) == -1)
+    {
+        fprintf(stderr, "error: invalid arena size %s.\n", opt_size);
+        return false;
+    }
+    if (opt_limit && (arena_limit = parse_size(opt_limit)) == -1)
+    {
+        fprintf(stderr, "error: invalid arena limit %s.\n", opt_limit);
+        return false;
+    }
+    if (arena_limit < arena_size) arena_limit = arena_size;
+    if (opt_zones && (arena_zones = parse_size(opt_zones)) == -1)
+    {
+        fprintf(stderr, "error: invalid zone boundary %s.\n", opt_zones);
+        return false;
+    }
+    if (opt_strategy)
+    {
+        int i = 0;
+        while (i < len_strategyStr && strcmp(opt_strategy, StrategyStr[i])) i++;
+        if (i == len_strategyStr)
+        {
+            fprintf(stderr, "error: unknown strategy %s.\n", opt_strategy);
+            return false;
+        }
+        strategy = (Strategy)i;
+    }
+    if (arena_image && is_engine(strategy))
+    {
+        fprintf(stderr, "error: --image needs a segment-list strategy (first, best, next, worst or segregated).\n");
+        return false;
+    }
+    if (arena_zones && is_engine(strategy))
+    {
+        fprintf(stderr, "error: --zones needs a segment-list strategy (first, best, next, worst or segregated).\n");
+        return false;
+    }
+    if (opt_trace)
+    {
+        mem_trace = new Trace_recorder();
+        if (!mem_trace->open(opt_trace, arena_size, arena_limit)) return false;
+    }
+    return true;
+}
+
+bool Init()
 {
     file_simulator = new File_simulator();
+    if (arena_image && !LoadImage(file_simulator, arena_image))
+    {
+        fprintf(stderr, "error: image %s not restored, left untouched.\n", arena_image);
+        return false;
+    }
+    image_defragments = file_simulator->defragments();
     constexpr static int len_operationStr = sizeof(OperationStr) / sizeof(OperationStr[0]);
     for (int i = 0; i < len_operationStr; i++)
         OperationDict[OperationStr[i]] = i;
+    return true;
 }
 
-int main()
+int main(int argc, char** argv)
 {
-    Init();
-    printf("\nFile Simulator: (strategy -- first fit)\n");
+    if (!Parse_args(argc, argv)) return 1;
+    if (!Init()) return 1;
+    printf("\nFile Simulator: (strategy -- %s, arena %d bytes, up to %d)\n", StrategyName[strategy], arena_size, arena_limit);
+    if (arena_image) printf("image: %s\n", arena_image);
+    if (arena_zones) printf("zones: above %d bytes placed apart\n", arena_zones);
 
     bool ext = false;
     File_simulator* new_simulator;
@@ -362,7 +478,22 @@ int main()
                 fclose(FILE_ISTREAM);
             break;
 
+            case Defrag:
+                file_simulator->defragment();
+            break;
+
+            case Memstat:
+                file_simulator->memstat();
+            break;
+
+            case Sync:
+                if (!arena_image) printf("no image.(start with --image <path>)\n");
+                else if (SaveImage(file_simulator, arena_image)) printf("success!\n");
+            break;
+
             case Exit:
+                if (arena_image) SaveImage(file_simulator, arena_image);
+                if (mem_trace) mem_trace->close();
                 ext = true;
                 printf("exit.\n");
             break;
@@ -370,6 +501,11 @@ int main()
             default:
                 ; // should never enter
         }
+        if (arena_image && !ext && file_simulator->defragments() != image_defragments) // compaction moved saved extents
+        {
+            image_defragments = file_simulator->defragments();
+            SaveImage(file_simulator, arena_image);
+        }
     }
     return 0;
 }
\ No newline at end of file